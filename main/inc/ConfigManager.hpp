@@ -4,66 +4,270 @@
  *
  * Manages user preferences for what content to display on the LED matrix,
  * including clock, weather, quotes, and custom text. Configuration is
- * stored in NVS for persistence across reboots.
+ * stored in NVS for persistence across reboots and served from RAM.
  */
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 /**
  * @struct DisplayConfig
  * @brief Configuration for display content modes
  *
- * Defines which content modes are enabled. The display cycles through
- * all enabled modes every 10 seconds.
+ * Defines which content modes are enabled. The display controller
+ * compiles them into its playlist whenever the config changes.
  */
 struct DisplayConfig
 {
+	static constexpr int MAX_WEATHER_LOCATIONS = 4;
+	static constexpr int WEATHER_LOCATION_LEN = 48;
+
 	bool showClock;            ///< Display current time
 	bool showWeather;          ///< Display weather information
+	bool showForecast;         ///< Display the multi-day forecast
 	bool showStarWarsQuotes;   ///< Display Star Wars quotes
 	bool showLOTRQuotes;       ///< Display Lord of the Rings quotes
 	bool displayFlipped;       ///< Flip display 180 degrees for upside-down mounting
 	uint8_t brightness;        ///< Display brightness (0-15, default 8)
+	uint8_t nightStartHour;    ///< Hour (0-23) the display blanks; equal to nightEndHour disables
+	uint8_t nightEndHour;      ///< Hour (0-23) the display comes back on
 	char customText[256];      ///< Custom user-defined text to scroll
 	char weatherApiKey[64];    ///< OpenWeather API key
+	char weatherLocations[MAX_WEATHER_LOCATIONS][WEATHER_LOCATION_LEN];  ///< OpenWeatherMap queries, e.g. "Sydney,AU"
+	uint8_t weatherLocationCount;  ///< Entries used in weatherLocations (at least 1)
+};
+
+/**
+ * @struct ConfigRecord
+ * @brief A published configuration and its version
+ *
+ * Immutable while published; see ConfigManager::read().
+ */
+struct ConfigRecord
+{
+	DisplayConfig config;
+	uint32_t version;
 };
 
 /**
  * @class ConfigManager
  * @brief Manages display configuration storage and retrieval
  *
- * Provides methods to save and load display preferences to/from NVS.
- * Configuration persists across device reboots.
+ * Owns the single authoritative copy of the configuration in RAM. It is
+ * read from NVS once at init(); saveConfig() publishes a complete new
+ * record with one atomic pointer swap and notifies change listeners.
+ * A background writer persists it to NVS once changes have been quiet
+ * for a moment, so bursts of saves coalesce into one flash commit.
+ *
+ * Up to MAX_PRESETS named configurations are kept in RAM and NVS. The
+ * active preset is the published config; saveConfig() edits it, and
+ * activatePreset() switches to another one with a single publish, so only
+ * the active preset id has to be written to flash.
+ *
+ * Hot readers register once and use read(), a single atomic load, marking
+ * quiescent states between uses (read-copy-update with quiescent-state
+ * based reclamation). Occasional readers use getConfig(), which copies.
  */
 class ConfigManager
 {
 public:
+	static constexpr int MAX_PRESETS = 4;
+	static constexpr size_t PRESET_NAME_LEN = 24;
+
+	/**
+	 * @brief Name and state of one preset slot
+	 */
+	struct PresetInfo
+	{
+		bool used;
+		char name[PRESET_NAME_LEN];
+	};
+
+	/**
+	 * @brief Counters for the background writer
+	 */
+	struct PersistStats
+	{
+		uint32_t saves;          ///< Config and preset changes
+		uint32_t commits;        ///< Blobs written to NVS
+		uint32_t coalesced;      ///< Saves folded into a later commit
+		uint32_t failures;       ///< Failed NVS writes (retried)
+		uint32_t lastCommitUs;   ///< Duration of the last NVS write
+		bool pending;            ///< A change is waiting to be written
+	};
+
 	/**
-	 * @brief Initialize configuration manager
+	 * @brief Callback invoked after a new configuration has been saved
+	 *
+	 * Runs on the saving task (usually the HTTP server), so implementations
+	 * must be short and must not block.
 	 *
-	 * Currently a placeholder as NVS is initialized by WifiManager.
+	 * @param version Version of the new configuration
+	 * @param ctx User context passed to addChangeListener()
+	 */
+	using ChangeCallback = void (*)(uint32_t version, void* ctx);
+
+	/**
+	 * @brief Load the stored configuration into RAM and start the writer
+	 *
+	 * Must run after NVS is initialized (by WifiManager) and before any
+	 * other ConfigManager call. Also registers a shutdown handler so a
+	 * pending change is written before esp_restart().
 	 */
 	static void init();
 
 	/**
-	 * @brief Save display configuration to NVS
+	 * @brief Publish a new display configuration and schedule its write
+	 *
+	 * Updates the active preset. The RAM copy is replaced, the version increases and every change
+	 * listener is called before this returns. The NVS write follows once
+	 * saves have been quiet for a short period, or at a deadline after the
+	 * first unwritten save, whichever comes first.
 	 *
 	 * @param config Configuration to save
-	 * @return true if saved successfully, false on error
+	 * @return true if published, false if the writer is not running and
+	 *         the direct NVS write failed
 	 */
 	static bool saveConfig(const DisplayConfig& config);
 
 	/**
-	 * @brief Load display configuration from NVS
+	 * @brief Id of the preset currently published
+	 */
+	static int getActivePreset();
+
+	/**
+	 * @brief Names and state of all preset slots
+	 *
+	 * @param presets Array of MAX_PRESETS entries to fill
+	 */
+	static void getPresets(PresetInfo* presets);
+
+	/**
+	 * @brief Copy a stored preset
+	 *
+	 * @return false if the id is out of range or the slot is empty
+	 */
+	static bool getPreset(int id, DisplayConfig& config);
+
+	/**
+	 * @brief Create or replace a preset
+	 *
+	 * Saving the active preset also publishes it, like saveConfig().
+	 *
+	 * @param id Slot, 0 to MAX_PRESETS - 1
+	 * @param name Non-empty display name, truncated to PRESET_NAME_LEN - 1
+	 * @param config Configuration to store
+	 * @return false on an invalid id or name
+	 */
+	static bool savePreset(int id, const char* name, const DisplayConfig& config);
+
+	/**
+	 * @brief Publish a stored preset as the current configuration
+	 *
+	 * One pointer swap in RAM; no fields are read back from NVS and only
+	 * the new active id is written. Change listeners are called as after
+	 * saveConfig().
+	 *
+	 * @return false if the id is out of range or the slot is empty
+	 */
+	static bool activatePreset(int id);
+
+	/**
+	 * @brief Remove a preset
 	 *
-	 * If no configuration exists in NVS, loads default configuration.
+	 * @return false if the slot is empty or holds the active preset
+	 */
+	static bool deletePreset(int id);
+
+	/**
+	 * @brief Write any pending change to NVS now
+	 *
+	 * @return true if nothing was pending or the write succeeded
+	 */
+	static bool flush();
+
+	/**
+	 * @brief Snapshot of the writer counters
+	 */
+	static void getPersistStats(PersistStats& stats);
+
+	/**
+	 * @brief Copy the current configuration
+	 *
+	 * Served from RAM; never touches NVS.
 	 *
-	 * @param config Output parameter for loaded configuration
-	 * @return true if loaded from NVS, false if using defaults
+	 * @param config Output parameter for the snapshot
+	 * @return Version of the snapshot
 	 */
-	static bool loadConfig(DisplayConfig& config);
+	static uint32_t getConfig(DisplayConfig& config);
+
+	/**
+	 * @brief Lock-free access to the published configuration
+	 *
+	 * The record stays valid until the calling reader's next quiescent()
+	 * or offline(). Only registered readers may call this.
+	 */
+	static const ConfigRecord* read();
+
+	/**
+	 * @brief Register the calling task as a lock-free reader
+	 *
+	 * The reader starts offline. Call once per task during startup.
+	 *
+	 * @return Reader id, or -1 if the reader table is full
+	 */
+	static int registerReader();
+
+	/**
+	 * @brief Declare that the reader holds no record
+	 *
+	 * Call between uses, e.g. once per loop iteration. Brings an offline
+	 * reader back online.
+	 */
+	static void quiescent(int reader);
+
+	/**
+	 * @brief Declare that the reader holds no record and will not read
+	 *        until its next quiescent()
+	 *
+	 * Call before blocking so writers never wait for a sleeping task.
+	 */
+	static void offline(int reader);
+
+	/**
+	 * @brief Version of the stored configuration
+	 *
+	 * Starts at 1 on boot and increases with every successful saveConfig(),
+	 * so callers can cache anything derived from the config and rebuild it
+	 * only when this changes. A single atomic load.
+	 */
+	static uint32_t getVersion();
+
+	/**
+	 * @brief Subscribe to configuration changes
+	 *
+	 * Listeners should be registered during startup.
+	 *
+	 * @param callback Function to call after each successful save
+	 * @param ctx User context passed back to the callback
+	 * @return true if registered, false if the listener table is full
+	 */
+	static bool addChangeListener(ChangeCallback callback, void* ctx);
+
+	/**
+	 * @brief Replace the weather location list
+	 *
+	 * Trims each entry and skips empty ones and entries beyond
+	 * MAX_WEATHER_LOCATIONS. An empty list falls back to the Kconfig
+	 * city and country.
+	 *
+	 * @param config Configuration to update
+	 * @param locations Location queries
+	 * @param count Number of entries in locations
+	 */
+	static void setWeatherLocations(DisplayConfig& config, const char* const* locations, int count);
 
 	/**
 	 * @brief Get default display configuration
@@ -73,4 +277,10 @@ public:
 	 * @param config Output parameter for default configuration
 	 */
 	static void getDefaultConfig(DisplayConfig& config);
+
+private:
+	static void loadFromNvs();
+	static bool scheduleWrite();
+	static void writerTaskMain(void* arg);
+	static void onShutdown();
 };
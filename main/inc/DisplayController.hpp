@@ -2,7 +2,9 @@
 
 #include "DisplayManager.hpp"
 #include "ConfigManager.hpp"
+#include "MessageQueue.hpp"
 #include "WeatherFetcher.hpp"
+#include <ctime>
 
 class DisplayController
 {
@@ -10,18 +12,118 @@ public:
 	DisplayController(DisplayManager* display);
 
 	void start();
-	void updateDisplay();
+
+	/**
+	 * @brief Advance the active content by one step
+	 *
+	 * Renders at most one frame and computes when the next one is due from
+	 * the active content: the next minute boundary for a static clock, the
+	 * frame interval while scrolling, or the end of night blanking.
+	 *
+	 * @return Milliseconds the caller may sleep before calling again
+	 */
+	uint32_t updateDisplay();
+
+	/**
+	 * @brief Sleep until the next frame is due or a new config is saved
+	 *
+	 * With CONFIG_PM_ENABLE and tickless idle the chip enters automatic
+	 * light sleep for the duration of the wait.
+	 *
+	 * @param delayMs Value returned by updateDisplay()
+	 */
+	void waitForNextFrame(uint32_t delayMs);
+
+	/**
+	 * @brief CPU duty cycle of the display task over the last window
+	 *
+	 * @return Busy time per mille of wall time (0-1000)
+	 */
+	static uint32_t getDutyCyclePermille();
+
+	/**
+	 * @brief Kinds of content a playlist item can show
+	 */
+	enum class ContentKind : uint8_t
+	{
+		Clock,
+		Weather,
+		Forecast,
+		StarWarsQuote,
+		LotrQuote,
+		CustomText,
+	};
 
 private:
-	void displayClock();
-	void displayWeather();
-	void displayQuote(bool starWars);
-	void displayCustomText();
+	static constexpr int CONTENT_KIND_COUNT = 6;
+	// Every kind once, weather and forecast once per location
+	static constexpr int MAX_PLAYLIST_ITEMS = CONTENT_KIND_COUNT + 2 * (DisplayConfig::MAX_WEATHER_LOCATIONS - 1);
+
+	/**
+	 * @brief One slot of the compiled rotation
+	 */
+	struct PlaylistItem
+	{
+		ContentKind kind;
+		uint32_t durationMs;   ///< 0 = one full scroll pass
+	};
+
+	// ConfigManager change listener; wakes the display task early
+	static void onConfigChanged(uint32_t version, void* ctx);
+	// MessageQueue arrival listener; same
+	static void onMessageQueued(void* ctx);
+	// Prepares the next playlist item on the other core
+	static void prefetchTaskMain(void* arg);
+
+	uint32_t renderFrame(uint32_t now);
+	void applyConfig(const DisplayConfig& config, uint32_t version);
+	void compilePlaylist();
+	void startItem(const PlaylistItem& item, uint32_t now);
+	void startScrollPass(ContentKind kind, uint8_t location);
+	void nextItem();
+	uint8_t claimLocation(ContentKind kind);
+	void queuePrefetch();
+	const DisplayManager::TextStrip* takePrefetched() const;
+	void beginMessage(const Message* message, MessagePriority priority, bool interrupt, uint32_t now);
+	uint32_t renderMessage(uint32_t now);
+	bool isNightTime(const struct tm& timeinfo) const;
+	void accountBusyTime(int64_t startUs);
+
+	uint32_t displayClock(uint32_t maxWaitMs);
 
 	DisplayManager* m_display = nullptr;
 	DisplayConfig m_config = {};
-	WeatherData m_weatherData = {};
-	uint32_t m_lastWeatherUpdate = 0;
-	int m_currentMode = 0;
-	uint32_t m_lastModeSwitch = 0;
+	uint32_t m_configVersion = 0;
+	int m_configReader = -1;
+	PlaylistItem m_playlist[MAX_PLAYLIST_ITEMS] = {};
+	int m_playlistLength = 0;
+	int m_playlistIndex = 0;
+	bool m_itemRunning = false;
+	uint32_t m_itemStartMs = 0;
+
+	// The next playlist item, queued when the current one starts: its
+	// location is claimed and, for scrolling content, a strip requested
+	bool m_itemQueued = false;
+	uint8_t m_queuedLocation = 0;
+	uint32_t m_queuedSequence = 0;   ///< Prefetch request, 0 = none
+	uint32_t m_lastSequence = 0;
+
+	// Message being shown, still owned by MessageQueue until popped
+	const Message* m_message = nullptr;
+	MessagePriority m_messagePriority = MessagePriority::Normal;
+	uint8_t m_messagePassesLeft = 0;
+	// A normal message was cut short by the high-priority one on screen
+	bool m_preemptedNormal = false;
+	// Playlist item interrupted by a high-priority message
+	bool m_resumeAfterMessage = false;
+	uint32_t m_suspendedAtMs = 0;
+	DisplayManager::ScrollState m_suspendedScroll;
+	int m_lastClockMinute = -1;
+	bool m_blanked = false;
+	bool m_idlePaused = false;
+	uint32_t m_idleUntil = 0;
+	uint8_t m_weatherRotation = 0;
+	uint8_t m_forecastRotation = 0;
+	int64_t m_dutyWindowStartUs = 0;
+	int64_t m_busyUs = 0;
 };
@@ -1,27 +1,94 @@
 #pragma once
 
 #include "MAX7219.hpp"
-#include <string>
+#include <cstddef>
+#include <cstdint>
 
 class DisplayManager
 {
 public:
+	/**
+	 * @brief Scroll text rasterized into pixel columns ahead of time
+	 *
+	 * One byte per column, bit n = font row n, already in draw order and
+	 * mirrored for a flipped display, so a scroll frame only copies a
+	 * window of columns into the display buffer.
+	 */
+	struct TextStrip
+	{
+		static constexpr size_t MAX_CHARS = 256;
+		static constexpr size_t MAX_COLUMNS = MAX_CHARS * 6;  // 5 pixels + 1 pixel spacing
+
+		uint8_t columns[MAX_COLUMNS];
+		uint16_t width;   ///< Columns in use
+		bool flipped;     ///< Rows are flipped when the strip is drawn
+	};
+
+	/**
+	 * @brief A scroll set aside by suspendScroll()
+	 */
+	struct ScrollState
+	{
+		const TextStrip* strip = nullptr;
+		int offset = 0;
+		bool scrolling = false;
+	};
+
 	DisplayManager(MAX7219* display);
 
 	void clear();
 	void displayText(const char* text, int startX = 0);
 	void scrollText(const char* text, int scrollSpeedMs = 50);
+	void startScroll(const char* text);
+
+	/**
+	 * @brief Scroll a strip prepared with rasterize()
+	 *
+	 * Only the pointer is kept; the strip must stay unchanged until the
+	 * scroll has finished or been replaced.
+	 */
+	void startScroll(const TextStrip* strip);
+	void stopScroll();
+	bool scrollStep();
+	bool isScrolling() const;
+
+	/**
+	 * @brief Move the current scroll into @p state and stop scrolling
+	 *
+	 * The strip is kept aside, not copied, so one scroll can be suspended
+	 * at a time.
+	 */
+	void suspendScroll(ScrollState& state);
+
+	/**
+	 * @brief Continue a suspended scroll from where it stopped
+	 */
+	void resumeScroll(ScrollState& state);
 	void displayClock(int hour, int minute, bool showSeconds = false);
+
+	/**
+	 * @brief Lay out and rasterize @p text for scrolling
+	 *
+	 * Touches no display state, so any task may prepare a strip while
+	 * another one is on screen. Text beyond TextStrip::MAX_CHARS is cut.
+	 */
+	static void rasterize(const char* text, bool flipped, TextStrip& strip);
 	void update();
 	void setFlipped(bool flipped);
 	void setBrightness(uint8_t intensity);
+	void setShutdown(bool shutdown);
 
 private:
 	void drawChar(char c, int xOffset);
+	void drawStripAt(const TextStrip& strip, int offset);
 	const uint8_t* getCharBitmap(char c);
 
 	MAX7219* m_display = nullptr;
 	int m_scrollOffset = 0;
-	std::string m_scrollText = "";
+	const TextStrip* m_strip = nullptr;
+	// Which of the two strips for startScroll(text) is free
+	int m_textStrip = 0;
+	bool m_scrolling = false;
 	bool m_flipped = false;
+	uint8_t m_brightness = 0xFF;
 };
@@ -0,0 +1,167 @@
+/**
+ * @file JsonScanner.hpp
+ * @brief Incremental, allocation-free JSON scanner
+ *
+ * Consumes a JSON document in arbitrary chunks (e.g. straight from
+ * HTTP_EVENT_ON_DATA) and reports every scalar value together with its
+ * path, so callers can pick out the few fields they need without
+ * buffering the body or building a DOM.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @enum JsonType
+ * @brief Kind of scalar value reported by JsonScanner
+ */
+enum class JsonType
+{
+	String,
+	Number,
+	Bool,
+	Null
+};
+
+/**
+ * @class JsonScanner
+ * @brief Streaming JSON tokenizer with a fixed-size path stack
+ *
+ * Memory use is constant: nesting is limited to MAX_DEPTH and deeper
+ * nesting fails the scan. Values longer than MAX_VALUE_LEN are truncated
+ * (isTruncated() tells the callback). A key longer than MAX_KEY_LEN is
+ * recorded as empty, so nothing below it matches a pattern by its prefix;
+ * hasTruncatedKey() reports that afterwards.
+ *
+ * Paths use dotted keys and bracketed indices, e.g. "main.temp" or
+ * "weather[0].description"; "[*]" matches any array index.
+ *
+ * Has no ESP-IDF dependencies so it can be compiled and exercised on a host.
+ */
+class JsonScanner
+{
+public:
+	static constexpr size_t MAX_DEPTH = 8;
+	static constexpr size_t MAX_KEY_LEN = 23;
+	static constexpr size_t MAX_VALUE_LEN = 255;
+
+	/**
+	 * @brief Called for every scalar value
+	 *
+	 * The scanner's path describes the value's location while this runs.
+	 * @p value is NUL-terminated; strings are unescaped.
+	 */
+	using ValueCallback = void (*)(const JsonScanner& scanner, JsonType type, const char* value, void* ctx);
+
+	/**
+	 * @brief Called when an object or array closes
+	 *
+	 * The scanner's path describes the container's own location.
+	 */
+	using ContainerEndCallback = void (*)(const JsonScanner& scanner, void* ctx);
+
+	JsonScanner(ValueCallback onValue, void* ctx, ContainerEndCallback onContainerEnd = nullptr);
+
+	/**
+	 * @brief Forget all state and start a new document
+	 */
+	void reset();
+
+	/**
+	 * @brief Consume the next chunk of the document
+	 *
+	 * @return false once the input is malformed or nests too deeply
+	 */
+	bool feed(const char* data, size_t len);
+
+	/**
+	 * @brief True once a complete top-level value has been consumed
+	 */
+	bool isComplete() const { return m_state == State::Done; }
+
+	/**
+	 * @brief True if the input was rejected
+	 */
+	bool hasFailed() const { return m_state == State::Error; }
+
+	/**
+	 * @brief Test the current path against a pattern
+	 *
+	 * @param pattern Path such as "list[*].main.temp"; "" matches the root
+	 */
+	bool matches(const char* pattern) const;
+
+	/**
+	 * @brief Current nesting depth (0 for the root value)
+	 */
+	size_t depth() const { return m_depth; }
+
+	/**
+	 * @brief Array index at a path level, or -1 if that level is an object
+	 */
+	int indexAt(size_t level) const;
+
+	/**
+	 * @brief True if the reported value was cut to fit
+	 */
+	bool isTruncated() const { return m_truncated; }
+
+	/**
+	 * @brief True if any key since reset() was longer than MAX_KEY_LEN
+	 */
+	bool hasTruncatedKey() const { return m_keyTruncated; }
+
+private:
+	enum class State : uint8_t
+	{
+		Value,
+		ArrayStart,
+		ObjectStart,
+		Key,
+		KeyString,
+		Colon,
+		ValueString,
+		Literal,
+		AfterValue,
+		Done,
+		Error
+	};
+
+	struct Level
+	{
+		bool isArray;
+		int index;
+		char key[MAX_KEY_LEN + 1];
+	};
+
+	bool step(char c);
+	bool beginValue(char c);
+	bool push(bool isArray);
+	bool pop(bool isArray);
+	size_t capacity() const;
+	void appendChar(char c);
+	void appendCodePoint(uint32_t cp);
+	void emit(JsonType type);
+	bool endLiteral();
+
+	ValueCallback m_onValue;
+	ContainerEndCallback m_onContainerEnd;
+	void* m_ctx;
+
+	State m_state = State::Value;
+	Level m_levels[MAX_DEPTH];
+	size_t m_depth = 0;
+
+	char m_value[MAX_VALUE_LEN + 1];
+	size_t m_valueLen = 0;
+	bool m_truncated = false;
+	bool m_keyTruncated = false;
+
+	// String escape handling, kept across chunk boundaries
+	bool m_escape = false;
+	uint8_t m_unicodeDigits = 0;
+	uint32_t m_codePoint = 0;
+	uint32_t m_highSurrogate = 0;
+};
@@ -0,0 +1,84 @@
+/**
+ * @file JsonWriter.hpp
+ * @brief Streaming JSON writer with a fixed output buffer
+ *
+ * Counterpart of JsonScanner: emits a document piece by piece into a small
+ * internal buffer and hands it to a flush callback whenever it fills, so a
+ * response of any size is produced without building a DOM or allocating.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class JsonWriter
+ * @brief Compact JSON emitter for objects, arrays and scalars
+ *
+ * Every add/begin call takes a key, which must be nullptr for array
+ * elements and the root value. Commas are inserted automatically. Nesting
+ * is limited to MAX_DEPTH; deeper calls, and any call after a failed
+ * flush, are ignored and make finish() return false.
+ *
+ * Has no ESP-IDF dependencies so it can be compiled and exercised on a host.
+ */
+class JsonWriter
+{
+public:
+	static constexpr size_t BUFFER_SIZE = 256;
+	static constexpr size_t MAX_DEPTH = 8;
+
+	/**
+	 * @brief Receives each full buffer, and the remainder from finish()
+	 *
+	 * @return false to abort the document (e.g. the client went away)
+	 */
+	using FlushCallback = bool (*)(const char* data, size_t len, void* ctx);
+
+	JsonWriter(FlushCallback flush, void* ctx);
+
+	void beginObject(const char* key = nullptr);
+	void endObject();
+	void beginArray(const char* key = nullptr);
+	void endArray();
+
+	void addBool(const char* key, bool value);
+	void addInt(const char* key, int64_t value);
+
+	/**
+	 * @brief Add a string, escaping quotes, backslashes and control characters
+	 *
+	 * '<' is escaped too, so the output can be embedded in an HTML script
+	 * element. A nullptr value is written as null. UTF-8 is passed through
+	 * unchanged.
+	 */
+	void addString(const char* key, const char* value);
+
+	/**
+	 * @brief Flush whatever is buffered
+	 *
+	 * @return true if the document is complete and every flush succeeded
+	 */
+	bool finish();
+
+private:
+	void beginValue(const char* key);
+	void beginContainer(const char* key, char open);
+	void endContainer(char close);
+	void writeEscaped(const char* text);
+	void write(const char* data, size_t len);
+	void put(char c);
+	bool flush();
+
+	FlushCallback m_flush;
+	void* m_ctx;
+
+	char m_buffer[BUFFER_SIZE];
+	size_t m_used = 0;
+
+	// Bit n set once level n holds a value, so the next one needs a comma
+	uint32_t m_hasValue = 0;
+	size_t m_depth = 0;
+	bool m_failed = false;
+};
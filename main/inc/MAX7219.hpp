@@ -12,6 +12,7 @@ public:
 	bool init(int clkPin, int mosiPin, int csPin);
 	void clear();
 	void setBrightness(uint8_t intensity);
+	void setShutdown(bool shutdown);
 	void setPixel(int device, int row, int col, bool on);
 	void setRow(int device, int row, uint8_t data);
 	void displayBuffer();
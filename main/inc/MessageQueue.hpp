@@ -0,0 +1,109 @@
+/**
+ * @file MessageQueue.hpp
+ * @brief One-off display messages pushed from the web server
+ *
+ * Messages skip the persisted config entirely: nothing is written to NVS
+ * and the display picks them up at its next frame boundary.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @enum MessagePriority
+ * @brief How urgently a message is shown
+ */
+enum class MessagePriority : uint8_t
+{
+	Normal,   ///< Shown when the current playlist item finishes
+	High,     ///< Interrupts the current item at the next frame, which then resumes
+	Count
+};
+
+/**
+ * @struct Message
+ * @brief A queued message
+ */
+struct Message
+{
+	static constexpr size_t MAX_TEXT_LEN = 128;
+
+	char text[MAX_TEXT_LEN];
+	uint8_t repeat;          ///< Scroll passes, at least 1
+	uint32_t expiresAtMs;    ///< Dropped if not shown by then (esp_timer milliseconds)
+};
+
+/**
+ * @struct MessageQueueStats
+ * @brief Counters since boot
+ */
+struct MessageQueueStats
+{
+	uint32_t queued;     ///< Accepted by push()
+	uint32_t rejected;   ///< Refused because the queue was full
+	uint32_t expired;    ///< Dropped unshown after their TTL
+	uint32_t shown;      ///< Fully displayed
+};
+
+/**
+ * @class MessageQueue
+ * @brief Bounded, lock-free message rings between web server and display
+ *
+ * One single-producer/single-consumer ring per priority. The httpd task is
+ * the only producer and the display task the only consumer, so head and
+ * tail are plain atomics and neither side ever blocks. A consumer check is
+ * one atomic load per ring while the queue is empty.
+ *
+ * A message stays in its ring slot while it is displayed and is released
+ * with pop() once it has finished, so the consumer never copies text.
+ */
+class MessageQueue
+{
+public:
+	static constexpr size_t CAPACITY = 4;   ///< Per priority
+
+	/**
+	 * @brief Called on the producer's task after each successful push()
+	 *
+	 * Must be short and must not block.
+	 */
+	using ArrivalCallback = void (*)(void* ctx);
+
+	/**
+	 * @brief Set the consumer's wake-up callback
+	 *
+	 * The display task sleeps between frames; this lets a message start
+	 * right away instead of at the next scheduled wake.
+	 */
+	static void setArrivalListener(ArrivalCallback callback, void* ctx);
+
+	/**
+	 * @brief Queue a message (producer side)
+	 *
+	 * @param text Text to scroll; truncated to Message::MAX_TEXT_LEN - 1 bytes
+	 * @param priority Normal or High
+	 * @param ttlSeconds How long the message may wait before being dropped
+	 * @param repeat Scroll passes, clamped to at least 1
+	 * @return false if the ring for this priority is full
+	 */
+	static bool push(const char* text, MessagePriority priority, uint32_t ttlSeconds, uint8_t repeat);
+
+	/**
+	 * @brief Oldest unexpired message of a priority (consumer side)
+	 *
+	 * Expired messages at the front are dropped on the way. The pointer
+	 * stays valid until pop() for the same priority.
+	 *
+	 * @return The message, or nullptr if none is waiting
+	 */
+	static const Message* peek(MessagePriority priority);
+
+	/**
+	 * @brief Release the message returned by peek() once it has been shown
+	 */
+	static void pop(MessagePriority priority);
+
+	static void getStats(MessageQueueStats& stats);
+};
@@ -0,0 +1,83 @@
+/**
+ * @file OpenWeatherMapProvider.hpp
+ * @brief OpenWeatherMap 2.5 current weather and 5-day forecast
+ */
+
+#pragma once
+
+#include "WeatherProvider.hpp"
+#include "JsonScanner.hpp"
+
+/**
+ * @class OpenWeatherMapProvider
+ * @brief WeatherProvider for the OpenWeatherMap 2.5 API
+ *
+ * Current conditions come from /data/2.5/weather; the forecast from
+ * /data/2.5/forecast, whose 3-hour slots are folded into their local
+ * calendar day as soon as each slot has been scanned, so the tens of
+ * kilobytes of response are never held in RAM. No heap allocation.
+ */
+class OpenWeatherMapProvider : public WeatherProvider
+{
+public:
+	const char* name() const override { return "OpenWeatherMap"; }
+
+	bool currentPath(const char* location, const char* apiKey, char* path, size_t size) const override;
+	bool forecastPath(const char* location, const char* apiKey, char* path, size_t size) const override;
+
+	ResponseParser& beginCurrent(WeatherData& data) override;
+	ResponseParser& beginForecast(ForecastData& forecast) override;
+
+private:
+	/**
+	 * @brief Picks main.temp, main.humidity, weather[0].description/icon and dt
+	 */
+	class CurrentParser : public ResponseParser
+	{
+	public:
+		CurrentParser();
+		void begin(WeatherData& data);
+		bool feed(const char* data, size_t len) override;
+		bool finish() override;
+
+	private:
+		static void onValue(const JsonScanner& scanner, JsonType type, const char* value, void* ctx);
+
+		JsonScanner m_scanner;
+		WeatherData* m_data = nullptr;
+		bool m_haveTemperature = false;
+	};
+
+	/**
+	 * @brief Reduces list[*] slots into ForecastDay entries
+	 */
+	class ForecastParser : public ResponseParser
+	{
+	public:
+		ForecastParser();
+		void begin(ForecastData& forecast);
+		bool feed(const char* data, size_t len) override;
+		bool finish() override;
+
+	private:
+		static void onValue(const JsonScanner& scanner, JsonType type, const char* value, void* ctx);
+		static void onContainerEnd(const JsonScanner& scanner, void* ctx);
+		void resetSlot();
+		void foldSlot();
+
+		JsonScanner m_scanner;
+		ForecastData* m_forecast = nullptr;
+
+		// The 3-hour slot currently being scanned
+		int64_t m_slotAt = 0;
+		float m_slotMin = 0.0f;
+		float m_slotMax = 0.0f;
+		float m_slotPop = 0.0f;
+		int m_slotConditionId = 0;
+	};
+
+	bool buildPath(const char* endpoint, const char* location, const char* apiKey, char* path, size_t size) const;
+
+	CurrentParser m_current;
+	ForecastParser m_forecast;
+};
@@ -25,10 +25,23 @@ public:
 	 * @brief Initialize SNTP time sync
 	 *
 	 * Sets up SNTP with configured server (CONFIG_NTP_SERVER)
-	 * and timezone (CONFIG_TIMEZONE).
+	 * and timezone (CONFIG_TIMEZONE). The SNTP client itself is only
+	 * started once the network is available (see onConnectivityChange()).
 	 */
 	static void init();
 
+	/**
+	 * @brief Pause or resume SNTP as network connectivity changes
+	 *
+	 * Matches WifiManager::ConnectivityCallback. Stops SNTP polling while
+	 * offline, and restarts it (forcing an immediate resync) when the link
+	 * comes back. The local clock keeps running in between.
+	 *
+	 * @param connected true if the network is up
+	 * @param ctx Unused
+	 */
+	static void onConnectivityChange(bool connected, void* ctx);
+
 	/**
 	 * @brief Trigger time synchronization
 	 *
@@ -1,64 +1,137 @@
 /**
  * @file WeatherFetcher.hpp
- * @brief OpenWeatherMap API integration for weather data
+ * @brief Background weather fetching and display formatting
  *
- * Fetches current weather information from OpenWeatherMap API
- * and parses the JSON response into a structured format.
+ * Fetches current weather and forecasts from a WeatherProvider and
+ * extracts the fields it needs while the response streams in.
  */
 
 #pragma once
 
-#include <string>
+#include "WeatherProvider.hpp"
+#include <cstddef>
+#include <cstdint>
+
+struct DisplayConfig;
 
 /**
- * @struct WeatherData
- * @brief Structured weather information
+ * @struct WeatherFetchStats
+ * @brief Timing breakdown of weather requests
  *
- * Contains parsed weather data from OpenWeatherMap API response.
+ * Connection setup includes the DNS lookup when one was needed and is
+ * zero when keep-alive reused the previous connection.
  */
-struct WeatherData
+struct WeatherFetchStats
 {
-	float temperature;      ///< Temperature in Celsius
-	int humidity;           ///< Relative humidity percentage (0-100)
-	char description[64];   ///< Weather description (e.g., "partly cloudy")
-	char icon[8];           ///< Weather icon code (e.g., "01d")
-	bool valid;             ///< True if data was successfully fetched
+	uint32_t fetches;             ///< Requests attempted
+	uint32_t failures;            ///< Requests that produced no usable data
+	uint32_t notModified;         ///< 304 responses (parsing skipped)
+	uint32_t newConnections;      ///< Requests that opened a TCP connection
+	uint32_t reusedConnections;   ///< Requests served on a kept-alive connection
+	bool lastReused;              ///< Whether the last request reused its connection
+	uint32_t lastDnsMs;           ///< DNS time of the last request (0 if cached)
+	uint32_t lastConnectMs;       ///< Connection setup of the last request
+	uint32_t lastTtfbMs;          ///< Request sent to first response header
+	uint32_t lastBodyMs;          ///< First body byte to end of response
+	uint32_t lastTotalMs;         ///< Whole request including DNS
+	uint32_t avgConnectMs;        ///< Average over new connections
+	uint32_t avgTtfbMs;           ///< Average time to first byte
+	uint32_t avgBodyMs;           ///< Average body transfer time
 };
 
 /**
  * @class WeatherFetcher
  * @brief Manages weather API requests and response parsing
  *
- * Uses OpenWeatherMap Current Weather API (v2.5) to fetch real-time
- * weather data. Requires internet connectivity and valid API key.
+ * Requests are phrased and parsed by a WeatherProvider (currently
+ * OpenWeatherMap) and sent to CONFIG_WEATHER_API_BASE_URL, which can point
+ * at a local replay server. Requires connectivity and a valid API key.
+ *
+ * All fetches run on a dedicated task, so rendering never waits on the
+ * network and two fetches can never overlap. Results are double-buffered:
+ * the task fills the back buffer and publishes it with an atomic index
+ * swap, and readers copy whichever buffer is currently published.
+ *
+ * The HTTP client lives as long as the task and uses keep-alive, the
+ * host's address is cached, and responses are revalidated with
+ * If-None-Match / If-Modified-Since when the server supplied validators.
+ *
+ * Every configured location (DisplayConfig::weatherLocations) gets a slot
+ * with its own results and schedule; identical queries share a slot.
+ * Slots are refreshed one at a time over the shared connection, with
+ * their hourly refreshes staggered across the hour.
+ *
+ * The last good observation of each slot is cached in NVS and published
+ * at start, so the display has data before the first fetch; it is flagged
+ * as stale once it gets too old. Failed fetches retry on a short backoff
+ * schedule.
  */
 class WeatherFetcher
 {
 public:
 	/**
-	 * @brief Fetch current weather from OpenWeatherMap
+	 * @brief Start the weather fetch task
+	 *
+	 * The task fetches once the network is up and weather display is
+	 * enabled, then refreshes hourly. Call during startup, before WiFi
+	 * connects, so it is subscribed to connectivity changes.
+	 */
+	static void start();
+
+	/**
+	 * @brief Ask the fetch task to refresh now
 	 *
-	 * Makes HTTP GET request to OpenWeatherMap API using API key from
-	 * configuration and city/country from sdkconfig. Parses JSON response
-	 * and populates WeatherData structure.
+	 * Non-blocking; use after the API key, locations or weather modes
+	 * changed.
+	 */
+	static void requestUpdate();
+
+	/**
+	 * @brief Copy the most recently published weather data of a location
 	 *
+	 * Never blocks on the network.
+	 *
+	 * @param location One of the configured location queries
 	 * @param data Output parameter for weather information
-	 * @param apiKey OpenWeather API key (if empty, uses CONFIG_OPENWEATHER_API_KEY)
-	 * @return true if fetch and parse successful, false on error
+	 * @return true if the copied data is valid
+	 */
+	static bool getLatest(const char* location, WeatherData& data);
+
+	/**
+	 * @brief Copy the most recently published forecast
 	 *
-	 * @note Requires:
-	 *  - WiFi connection
-	 *  - Valid API key
-	 *  - CONFIG_WEATHER_CITY set
-	 *  - CONFIG_WEATHER_COUNTRY_CODE set
+	 * Never blocks on the network.
+	 *
+	 * @param location One of the configured location queries
+	 * @param forecast Output parameter for the forecast
+	 * @return true if the copied forecast is valid
 	 */
-	static bool fetchWeather(WeatherData& data, const char* apiKey = nullptr);
+	static bool getForecast(const char* location, ForecastData& forecast);
+
+	/**
+	 * @brief Check whether an observation is too old to present as current
+	 *
+	 * While the clock is not synced the age cannot be computed, so only
+	 * data restored from the cache counts as stale.
+	 *
+	 * @param data Weather data to check
+	 * @return true if the data is older than the stale threshold
+	 */
+	static bool isStale(const WeatherData& data);
+
+	/**
+	 * @brief Copy the request timing statistics
+	 *
+	 * @param stats Output parameter for the statistics
+	 */
+	static void getFetchStats(WeatherFetchStats& stats);
 
 	/**
 	 * @brief Format weather data as display string
 	 *
 	 * Creates human-readable string from weather data in format:
-	 * "TEMP°C HUMIDITY% DESCRIPTION"
+	 * "TEMP°C HUMIDITY% DESCRIPTION", followed by the age in hours
+	 * (or "cached" if unknown) when the data is stale.
 	 *
 	 * @param data Weather data to format
 	 * @param buffer Output buffer for formatted string
@@ -66,15 +139,130 @@ public:
 	 */
 	static void formatWeatherString(const WeatherData& data, char* buffer, size_t size);
 
+	/**
+	 * @brief Format the forecast as display string
+	 *
+	 * One entry per day from today on, e.g.
+	 * "Today 14/6C Rain 60%  Tue 15/7C Clear 0%  Wed 12/5C Clouds 20%".
+	 * Days that have already ended are skipped.
+	 *
+	 * @param forecast Forecast to format
+	 * @param buffer Output buffer for formatted string
+	 * @param size Buffer size
+	 */
+	static void formatForecastString(const ForecastData& forecast, char* buffer, size_t size);
+
 private:
+	enum class FetchResult
+	{
+		Updated,       ///< New data parsed into the output
+		NotModified,   ///< Server answered 304; published data still current
+		Failed
+	};
+
 	/**
-	 * @brief Parse OpenWeatherMap JSON response
+	 * @brief Fetch current weather from the provider
 	 *
-	 * Extracts temperature, humidity, and description from JSON.
+	 * Makes HTTP GET request using API key from configuration. Streams the
+	 * response into the provider's parser, which populates WeatherData.
+	 * Only called from the fetch task.
 	 *
-	 * @param json Raw JSON response string
-	 * @param data Output parameter for parsed data
-	 * @return true if parsing successful, false on error
+	 * @param location Location query, e.g. "Sydney,AU"
+	 * @param data Output parameter for weather information
+	 * @param apiKey OpenWeather API key (if empty, uses CONFIG_OPENWEATHER_API_KEY)
+	 * @param revalidate Send validators from the last 200; only when the
+	 *        caller still holds that response's data, since a 304 carries none
+	 * @return Updated on a parsed 200, NotModified on 304, Failed otherwise
+	 *
+	 * @note Requires:
+	 *  - WiFi connection
+	 *  - Valid API key
+	 */
+	static FetchResult fetchWeather(const char* location, WeatherData& data, const char* apiKey = nullptr,
+	                                bool revalidate = false);
+
+	/**
+	 * @brief API key to use, falling back to CONFIG_OPENWEATHER_API_KEY
+	 *
+	 * @return nullptr if neither is set
+	 */
+	static const char* resolveApiKey(const char* apiKey);
+
+	/**
+	 * @brief Fetch the 5-day / 3-hour forecast and reduce it per day
+	 *
+	 * The response is tens of kilobytes; the provider's parser reduces it
+	 * while it streams in, so the body is never held in RAM.
+	 *
+	 * @param location Location query, e.g. "Sydney,AU"
+	 * @param forecast Output parameter for the per-day summary
+	 * @param apiKey OpenWeather API key (if empty, uses CONFIG_OPENWEATHER_API_KEY)
+	 * @param revalidate As for fetchWeather()
+	 * @return Updated on a parsed 200, NotModified on 304, Failed otherwise
+	 */
+	static FetchResult fetchForecast(const char* location, ForecastData& forecast, const char* apiKey,
+	                                 bool revalidate = false);
+
+	/**
+	 * @brief Send a GET for an API path, streaming the body into a parser
+	 *
+	 * Reuses the kept-alive client and, with @p revalidate, adds
+	 * revalidation headers when validators are known for this path.
+	 *
+	 * @return Updated if a 200 body was scanned, NotModified on 304, Failed otherwise
+	 */
+	static FetchResult performRequest(const char* path, ResponseParser& parser, bool revalidate);
+
+	/**
+	 * @brief Remember validators after a good response and record stats
+	 *
+	 * @param path Request path passed to performRequest()
+	 * @param result Final outcome after parsing
+	 */
+	static void finishRequest(const char* path, FetchResult result);
+
+	/**
+	 * @brief Resolve the API host, reusing the cached address while fresh
+	 *
+	 * @return true if an address is available
+	 */
+	static bool resolveHost();
+
+	/**
+	 * @brief Match the configured locations to slots and schedule new ones
+	 *
+	 * @param config Current configuration
+	 * @param refreshAll Make every active slot due now
+	 */
+	static void reconcileLocations(const DisplayConfig& config, bool refreshAll);
+
+	/**
+	 * @brief Fetch the enabled kinds of data for one slot and reschedule it
+	 */
+	static void refreshLocation(int slotIndex, const DisplayConfig& config);
+
+	/**
+	 * @brief Publish the cached observations from NVS, if any
+	 */
+	static void loadCache();
+
+	/**
+	 * @brief Persist an observation as the slot's cache entry
+	 */
+	static void saveCache(int slotIndex, const WeatherData& data);
+
+	/**
+	 * @brief Fold the timings of the request that just ended into the stats
+	 */
+	static void recordFetch(FetchResult result);
+
+	/**
+	 * @brief Fetch task body
+	 */
+	static void taskMain(void* arg);
+
+	/**
+	 * @brief Pause/resume fetching as network connectivity changes
 	 */
-	static bool parseWeatherJSON(const char* json, WeatherData& data);
+	static void onConnectivityChange(bool connected, void* ctx);
 };
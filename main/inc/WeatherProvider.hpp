@@ -0,0 +1,168 @@
+/**
+ * @file WeatherProvider.hpp
+ * @brief Interface between WeatherFetcher and a weather API
+ *
+ * A provider knows how to phrase requests for one weather API and how to
+ * turn its streamed responses into WeatherData and ForecastData. Transport,
+ * scheduling and caching stay in WeatherFetcher.
+ *
+ * Has no ESP-IDF dependencies so providers can be compiled and exercised
+ * on a host.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+/**
+ * @struct WeatherData
+ * @brief Structured weather information
+ *
+ * Contains weather data parsed from a provider's response.
+ */
+struct WeatherData
+{
+	float temperature;      ///< Temperature in Celsius
+	int humidity;           ///< Relative humidity percentage (0-100)
+	char description[64];   ///< Weather description (e.g., "partly cloudy")
+	char icon[8];           ///< Weather icon code (e.g., "01d")
+	int64_t observedAt;     ///< Observation time in Unix seconds (0 if unknown)
+	bool fromCache;         ///< Restored from NVS rather than fetched this boot
+	bool valid;             ///< True if data was successfully fetched
+};
+
+/**
+ * @enum WeatherCondition
+ * @brief Provider-independent weather condition groups
+ *
+ * Unknown comes first so a zero-initialised day never claims a real
+ * condition. The groups after it are ordered by severity; ties in a day's
+ * dominant condition go to the more severe group.
+ */
+enum class WeatherCondition : uint8_t
+{
+	Unknown,   ///< No slot of the day reported a condition
+	Storm,
+	Snow,
+	Rain,
+	Drizzle,
+	Fog,       ///< Mist, fog, haze, ...
+	Clouds,
+	Clear,
+	Count
+};
+
+/**
+ * @struct ForecastDay
+ * @brief One local calendar day reduced from 3-hour forecast slots
+ */
+struct ForecastDay
+{
+	int64_t firstSlotAt;          ///< Unix time of the first slot of the day
+	int32_t dayKey;               ///< Local date as YYYYMMDD
+	float minTemp;                ///< Lowest slot temperature (Celsius)
+	float maxTemp;                ///< Highest slot temperature (Celsius)
+	uint8_t precipChance;         ///< Highest probability of precipitation (0-100)
+	WeatherCondition condition;   ///< Most frequent condition group
+	uint8_t conditionSlots[static_cast<int>(WeatherCondition::Count)];  ///< Slots per group
+};
+
+/**
+ * @struct ForecastData
+ * @brief Fixed-size per-day forecast summary
+ *
+ * Slots arrive in time order, so days fill up front to back and slots
+ * beyond the last day are dropped; nothing depends on the response size.
+ */
+struct ForecastData
+{
+	static constexpr int MAX_DAYS = 4;      ///< Today may already have ended when shown
+	static constexpr int SHOWN_DAYS = 3;    ///< Today, tomorrow, the day after
+
+	ForecastDay days[MAX_DAYS];
+	uint8_t dayCount;
+	bool valid;
+
+	/**
+	 * @brief Local calendar date of a Unix time as YYYYMMDD
+	 */
+	static int32_t dayKeyFor(int64_t unixTime)
+	{
+		time_t t = static_cast<time_t>(unixTime);
+		struct tm timeinfo;
+		localtime_r(&t, &timeinfo);
+		return (timeinfo.tm_year + 1900) * 10000 + (timeinfo.tm_mon + 1) * 100 + timeinfo.tm_mday;
+	}
+};
+
+/**
+ * @class ResponseParser
+ * @brief Incremental consumer of one response body
+ */
+class ResponseParser
+{
+public:
+	virtual ~ResponseParser() = default;
+
+	/**
+	 * @brief Consume the next chunk of the body
+	 *
+	 * @return false once the body is known to be unusable
+	 */
+	virtual bool feed(const char* data, size_t len) = 0;
+
+	/**
+	 * @brief Called after the last chunk
+	 *
+	 * @return true if the output is complete and usable
+	 */
+	virtual bool finish() = 0;
+};
+
+/**
+ * @class WeatherProvider
+ * @brief A weather API: request paths and response parsers
+ *
+ * Parsers are owned by the provider and write into the output passed to
+ * begin*(); only one request may be in flight per provider.
+ */
+class WeatherProvider
+{
+public:
+	virtual ~WeatherProvider() = default;
+
+	/**
+	 * @brief Human-readable provider name for logs
+	 */
+	virtual const char* name() const = 0;
+
+	/**
+	 * @brief Build the path and query for current conditions
+	 *
+	 * @param location Location query, e.g. "Sydney,AU"
+	 * @param apiKey API key
+	 * @param path Output buffer, relative to the configured base URL
+	 * @param size Buffer size
+	 * @return false if the path does not fit
+	 */
+	virtual bool currentPath(const char* location, const char* apiKey, char* path, size_t size) const = 0;
+
+	/**
+	 * @brief Build the path and query for the multi-day forecast
+	 *
+	 * @see currentPath()
+	 */
+	virtual bool forecastPath(const char* location, const char* apiKey, char* path, size_t size) const = 0;
+
+	/**
+	 * @brief Start parsing a current-conditions response into @p data
+	 */
+	virtual ResponseParser& beginCurrent(WeatherData& data) = 0;
+
+	/**
+	 * @brief Start parsing a forecast response into @p forecast
+	 */
+	virtual ResponseParser& beginForecast(ForecastData& forecast) = 0;
+};
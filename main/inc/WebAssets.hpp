@@ -0,0 +1,33 @@
+/**
+ * @file WebAssets.hpp
+ * @brief Web UI assets embedded at build time
+ *
+ * The table is generated from main/web by tools/build_web_assets.py:
+ * every asset is minified, stored both plain and gzipped, and carries a
+ * strong ETag derived from its content.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @struct WebAsset
+ * @brief One embedded file and its caching metadata
+ */
+struct WebAsset
+{
+	const char* path;          ///< Request path, e.g. "/assets/app.<hash>.js"
+	const char* contentType;   ///< Content-Type header value
+	const char* etag;          ///< Quoted content hash
+	const uint8_t* data;       ///< Minified bytes
+	size_t len;
+	const uint8_t* gzipData;   ///< Same bytes, gzip-compressed (nullptr if spliced)
+	size_t gzipLen;
+	size_t spliceOffset;       ///< Where the config JSON goes, or 0 for a static asset
+	bool immutable;            ///< Hashed name, safe to cache forever
+};
+
+extern const WebAsset WEB_ASSETS[];
+extern const size_t WEB_ASSET_COUNT;
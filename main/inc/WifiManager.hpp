@@ -7,10 +7,13 @@
  * - Managing WiFi credentials
  * - Creating a configuration Access Point (AP)
  * - Connecting to saved WiFi networks
+ * - Supervising the STA link and reconnecting with backoff
  */
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 /**
@@ -24,6 +27,91 @@
 class WifiManager
 {
 public:
+	/**
+	 * @brief Callback invoked when STA connectivity changes
+	 *
+	 * Called from the default event loop task, so implementations must be
+	 * short and must not block.
+	 *
+	 * @param connected true when an IP address was obtained, false when the link was lost
+	 * @param ctx User context passed to addConnectivityListener()
+	 */
+	using ConnectivityCallback = void (*)(bool connected, void* ctx);
+
+	/**
+	 * @brief Progress of a live credential switchover
+	 */
+	enum class SwitchState : uint8_t
+	{
+		Idle,         ///< No switchover requested since boot
+		InProgress,   ///< Trying the new network
+		Succeeded,    ///< Connected and credentials committed to NVS
+		Failed,       ///< New network unreachable, previous setup restored
+	};
+
+	/**
+	 * @brief STA power-save profile
+	 *
+	 * Trades HTTP latency for current draw. Modem sleep only applies in
+	 * STA mode; it is suspended by the driver while the config AP runs.
+	 */
+	enum class PowerProfile : uint8_t
+	{
+		None,       ///< Radio always on, lowest latency
+		MinModem,   ///< Wake every DTIM period (ESP-IDF default)
+		MaxModem,   ///< Wake every listen interval, lowest power
+		Count,
+	};
+
+	/**
+	 * @brief Which side started a timed request
+	 */
+	enum class RequestDirection : uint8_t
+	{
+		Outbound,   ///< Sent by the device (weather fetches)
+		Inbound,    ///< Served by the device (web UI and API)
+		Count,
+	};
+
+	/**
+	 * @brief Latency of the requests in one direction
+	 */
+	struct LatencyStats
+	{
+		uint32_t requests;          ///< Requests recorded while the profile was active
+		uint32_t avgLatencyMs;      ///< Mean request latency
+		uint32_t maxLatencyMs;      ///< Worst request latency
+	};
+
+	/**
+	 * @brief Observed statistics for one power profile
+	 *
+	 * Outbound latency covers a whole weather fetch. Inbound latency runs
+	 * from handler entry until the response is handed to the network
+	 * stack; the delay before a request reaches a dozing STA is not
+	 * visible on the device. The radio wake figures are estimates derived
+	 * from the time spent in the profile and the beacon period, since the
+	 * driver exposes no wake counter.
+	 */
+	struct PowerStats
+	{
+		LatencyStats outbound;
+		LatencyStats inbound;
+		uint32_t activeSeconds;     ///< Time spent in this profile
+		uint32_t wakeIntervalMs;    ///< Expected radio wake interval (0 = never sleeps)
+		uint32_t estimatedWakes;    ///< activeSeconds / wakeIntervalMs
+		uint32_t beaconTimeouts;    ///< Beacons missed by the STA
+	};
+
+	/**
+	 * @brief Snapshot of the most recent credential switchover
+	 */
+	struct SwitchStatus
+	{
+		SwitchState state;   ///< Current switchover state
+		char ssid[33];       ///< SSID being (or last) tried
+	};
+
 	/**
 	 * @brief Initialize WiFi subsystem and NVS
 	 *
@@ -45,8 +133,14 @@ public:
 	/**
 	 * @brief Connect to previously saved WiFi network
 	 *
-	 * Attempts to connect using credentials stored in NVS.
-	 * Does nothing if no credentials are saved.
+	 * Attempts to connect using credentials stored in NVS and starts the
+	 * reconnection supervisor. Whenever the link drops, the supervisor
+	 * retries with exponential backoff and jitter, bounded by
+	 * CONFIG_ESP_WIFI_RECONNECT_MAX_MS, and never gives up. After MAX_RETRY
+	 * failed attempts the configuration AP is brought up alongside the STA
+	 * interface: always if no connection has succeeded since boot, so wrong
+	 * stored credentials can be corrected, and on later outages only with
+	 * CONFIG_ESP_WIFI_FALLBACK_AP enabled.
 	 */
 	static void connectToConfiguredWiFi();
 
@@ -59,6 +153,79 @@ public:
 	 */
 	static bool saveWiFiConfig(const char* ssid, const char* password);
 
+	/**
+	 * @brief Switch to new WiFi credentials without rebooting
+	 *
+	 * Hands the credentials to the supervisor task and returns immediately.
+	 * The supervisor keeps the configuration AP up, retargets the STA
+	 * interface at the new network and only commits the credentials to NVS
+	 * once an IP address is obtained. If the new network cannot be joined
+	 * within the switch timeout, the previous STA configuration (or AP-only
+	 * mode) is restored. Progress is reported through getSwitchStatus().
+	 *
+	 * @param ssid WiFi network name (1-32 characters)
+	 * @param password WiFi password (up to 64 characters)
+	 * @return true if the switchover was queued, false on invalid input
+	 */
+	static bool applyWiFiConfig(const char* ssid, const char* password);
+
+	/**
+	 * @brief Get progress of the most recent credential switchover
+	 *
+	 * @param status Output parameter for the switchover status
+	 */
+	static void getSwitchStatus(SwitchStatus& status);
+
+	/**
+	 * @brief Select the STA power-save profile
+	 *
+	 * Applies the profile immediately and persists it to NVS. A new listen
+	 * interval only takes effect on association, so changing it while
+	 * connected in MaxModem triggers a reconnect.
+	 *
+	 * @param profile Power-save profile
+	 * @param listenInterval Beacon intervals between wakes in MaxModem (1-10)
+	 * @return true if applied and saved, false on error
+	 */
+	static bool setPowerProfile(PowerProfile profile, uint16_t listenInterval);
+
+	/**
+	 * @brief Get the active power-save profile
+	 */
+	static PowerProfile getPowerProfile();
+
+	/**
+	 * @brief Get the configured MaxModem listen interval
+	 */
+	static uint16_t getListenInterval();
+
+	/**
+	 * @brief Record the latency of a network request
+	 *
+	 * Attributed to the power profile active at the time of the call.
+	 *
+	 * @param direction Whether the device sent or served the request
+	 * @param latencyMs Request duration in milliseconds
+	 */
+	static void recordRequestLatency(RequestDirection direction, uint32_t latencyMs);
+
+	/**
+	 * @brief Get observed statistics for a power profile
+	 *
+	 * @param profile Profile to report
+	 * @param stats Output parameter for the statistics
+	 */
+	static void getPowerStats(PowerProfile profile, PowerStats& stats);
+
+	/**
+	 * @brief Format the current STA IP address
+	 *
+	 * @param buffer Output buffer (at least 16 bytes)
+	 * @param size Buffer size
+	 * @return true if connected and the address was written
+	 */
+	static bool getIPAddress(char* buffer, size_t size);
+
 	/**
 	 * @brief Check if WiFi credentials are stored
 	 *
@@ -69,11 +236,15 @@ public:
 	/**
 	 * @brief Retrieve stored WiFi credentials
 	 *
+	 * Buffers must leave room for the terminator: 33 bytes for a 32-character
+	 * SSID, 65 for a 64-character password.
+	 *
 	 * @param ssid Buffer to store SSID
+	 * @param ssidSize Size of the SSID buffer
 	 * @param password Buffer to store password
-	 * @param max_len Maximum buffer size
+	 * @param passwordSize Size of the password buffer
 	 */
-	static void getConfiguredWiFi(char* ssid, char* password, size_t max_len);
+	static void getConfiguredWiFi(char* ssid, size_t ssidSize, char* password, size_t passwordSize);
 
 	/**
 	 * @brief Check WiFi connection status
@@ -85,7 +256,27 @@ public:
 	/**
 	 * @brief Block until WiFi connection is established
 	 *
-	 * Waits up to a maximum retry count for connection.
+	 * Waits up to a maximum retry count for connection. The supervisor keeps
+	 * retrying in the background after this returns unsuccessfully.
 	 */
 	static void waitForConnection();
+
+	/**
+	 * @brief Check whether the configuration AP is currently running
+	 *
+	 * @return true in AP-only mode or while the fallback AP is up, false otherwise
+	 */
+	static bool isConfigAPActive();
+
+	/**
+	 * @brief Subscribe to STA connectivity changes
+	 *
+	 * Listeners should be registered during startup, before
+	 * connectToConfiguredWiFi() is called.
+	 *
+	 * @param callback Function to call on connect/disconnect
+	 * @param ctx User context passed back to the callback
+	 * @return true if registered, false if the listener table is full
+	 */
+	static bool addConnectivityListener(ConnectivityCallback callback, void* ctx);
 };
@@ -4,11 +4,13 @@
 #include "esp_log.h"
 #include "esp_system.h"
 #include "driver/gpio.h"
+#include "esp_pm.h"
 
 #include "WifiManager.hpp"
 #include "WebServer.hpp"
 #include "ConfigManager.hpp"
 #include "TimeSync.hpp"
+#include "WeatherFetcher.hpp"
 #include "MAX7219.hpp"
 #include "DisplayManager.hpp"
 #include "DisplayController.hpp"
@@ -24,10 +26,30 @@ extern "C" void app_main(void)
 {
 	ESP_LOGI(TAG, "ESP Clock starting...");
 
+#if CONFIG_ESP_CLOCK_LIGHT_SLEEP
+	// Let the idle task enter light sleep between display frames
+	esp_pm_config_t pmConfig = {};
+	pmConfig.max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+	pmConfig.min_freq_mhz = CONFIG_XTAL_FREQ;
+	pmConfig.light_sleep_enable = true;
+	esp_err_t pmErr = esp_pm_configure(&pmConfig);
+	if (pmErr != ESP_OK)
+	{
+		ESP_LOGW(TAG, "Automatic light sleep unavailable: %s", esp_err_to_name(pmErr));
+	}
+#endif
+
 	// Initialize managers
 	WifiManager::init();
 	ConfigManager::init();
 
+	// SNTP pauses/resumes with the STA link, so subscribe before connecting
+	TimeSync::init();
+	WifiManager::addConnectivityListener(TimeSync::onConnectivityChange, nullptr);
+
+	// Weather refreshes on its own task once the network is up
+	WeatherFetcher::start();
+
 	// Check if WiFi is configured
 	if (WifiManager::hasConfiguredWiFi())
 	{
@@ -38,15 +60,11 @@ extern "C" void app_main(void)
 		if (WifiManager::isConnected())
 		{
 			ESP_LOGI(TAG, "WiFi connected successfully");
-
-			// Initialize time sync
-			TimeSync::init();
 			TimeSync::syncTime();
 		}
 		else
 		{
-			ESP_LOGW(TAG, "Failed to connect to WiFi, starting AP mode");
-			WifiManager::startConfigAP();
+			ESP_LOGW(TAG, "Failed to connect to WiFi, retrying in background");
 		}
 	}
 	else
@@ -75,7 +93,7 @@ extern "C" void app_main(void)
 
 	// Load config and apply flip setting before showing startup message
 	DisplayConfig config;
-	ConfigManager::loadConfig(config);
+	ConfigManager::getConfig(config);
 	displayManager.setFlipped(config.displayFlipped);
 	displayManager.setBrightness(config.brightness);
 
@@ -87,10 +105,10 @@ extern "C" void app_main(void)
 
 	ESP_LOGI(TAG, "ESP Clock initialization complete");
 
-	// Main loop
+	// Main loop: sleep exactly as long as the active content allows
 	while (true)
 	{
-		displayController.updateDisplay();
-		vTaskDelay(pdMS_TO_TICKS(100));
+		uint32_t sleepMs = displayController.updateDisplay();
+		displayController.waitForNextFrame(sleepMs);
 	}
 }
@@ -2,128 +2,978 @@
 #include "esp_log.h"
 #include "nvs_flash.h"
 #include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_rom_crc.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include <atomic>
+#include <cstdio>
 #include <cstring>
 
 namespace
 {
 	const char* TAG = "ConfigManager";
+
+	/**
+	 * Each preset is one NVS blob: a header, then the payload. The payload
+	 * layout is append-only; each schema bump adds fields at the end. A
+	 * blob from an older schema is shorter, and the fields it lacks keep
+	 * their defaults, so migrating it needs no per-version code.
+	 */
+	const char* PRESET_KEY_FORMAT = "preset%d";
+	const char* ACTIVE_PRESET_KEY = "preset_active";
+	const uint8_t CONFIG_SCHEMA = 2;
+
+	// Single-config blob written before presets existed; becomes preset 0
+	const char* LEGACY_BLOB_KEY = "display_cfg";
+	const char* MIGRATED_PRESET_NAME = "Default";
+
+	struct ConfigBlobHeader
+	{
+		uint8_t schema;
+		uint8_t reserved;
+		uint16_t length;   // Payload bytes
+		uint32_t crc;      // CRC-32 of the payload
+	};
+
+	// Fixed-width fields only, so the layout doesn't depend on DisplayConfig
+	struct ConfigBlobPayload
+	{
+		// Schema 1
+		uint8_t flags;
+		uint8_t brightness;
+		uint8_t nightStartHour;
+		uint8_t nightEndHour;
+		char customText[256];
+		char weatherApiKey[64];
+		uint8_t weatherLocationCount;
+		char weatherLocations[DisplayConfig::MAX_WEATHER_LOCATIONS][DisplayConfig::WEATHER_LOCATION_LEN];
+		// Schema 2
+		char presetName[ConfigManager::PRESET_NAME_LEN];
+	};
+
+	struct ConfigBlob
+	{
+		ConfigBlobHeader header;
+		ConfigBlobPayload payload;
+	};
+
+	static_assert(sizeof(ConfigBlobHeader) == 8, "Config blob header layout changed");
+	static_assert(sizeof(ConfigBlobPayload) == 541, "Schema 2 layout changed; append fields and bump CONFIG_SCHEMA");
+
+	enum ConfigFlags : uint8_t
+	{
+		FLAG_CLOCK = 1 << 0,
+		FLAG_WEATHER = 1 << 1,
+		FLAG_FORECAST = 1 << 2,
+		FLAG_STAR_WARS = 1 << 3,
+		FLAG_LOTR = 1 << 4,
+		FLAG_FLIPPED = 1 << 5,
+	};
+
+	// Pre-blob layout: one NVS entry per field, migrated on first boot
+	const char* LEGACY_KEYS[] = {
+		"show_clock", "show_weather", "show_forecast", "show_sw", "show_lotr", "flip_display",
+		"brightness", "night_start", "night_end", "custom_text", "api_key", "weather_locs",
+	};
+
+	// Legacy locations are stored as one string, separated by newlines
+	const char LOCATION_SEPARATOR = '\n';
+	const size_t LOCATIONS_STR_LEN = DisplayConfig::MAX_WEATHER_LOCATIONS * DisplayConfig::WEATHER_LOCATION_LEN;
+
+	const int MAX_CHANGE_LISTENERS = 4;
+
+	struct ChangeListener
+	{
+		ConfigManager::ChangeCallback callback;
+		void* ctx;
+	};
+
+	ChangeListener listeners[MAX_CHANGE_LISTENERS] = {};
+	int listenerCount = 0;
+
+	/**
+	 * Read-copy-update publication. Each save fills a free record and
+	 * publishes it with one atomic pointer store; lock-free readers load
+	 * that pointer. A replaced record is retired at the new version and is
+	 * reused only once every registered reader has either gone offline or
+	 * announced a quiescent state at that version or later (QSBR), so no
+	 * reader can still be looking at it.
+	 */
+	const int RECORD_COUNT = 4;
+	const int MAX_READERS = 4;
+	const uint32_t RECORD_PUBLISHED = UINT32_MAX;
+	const uint32_t RECORD_RESERVED = UINT32_MAX - 1;
+	const uint32_t READER_OFFLINE = 0;
+
+	struct RecordSlot
+	{
+		ConfigRecord record;
+		std::atomic<uint32_t> retiredAt;   // 0 = never used, RECORD_PUBLISHED = current,
+		                                   // RECORD_RESERVED = claimed by a writer
+	};
+
+	RecordSlot records[RECORD_COUNT] = {};
+	std::atomic<const ConfigRecord*> published{nullptr};
+	std::atomic<uint32_t> configVersion{1};
+
+	// Last version each reader saw while holding no record, or READER_OFFLINE
+	std::atomic<uint32_t> readerEpochs[MAX_READERS] = {};
+	std::atomic<int> readerCount{0};
+
+	// Serializes writers and the copying getConfig(); readers never take it
+	SemaphoreHandle_t configMutex = nullptr;
+
+	struct Preset
+	{
+		bool used;
+		char name[ConfigManager::PRESET_NAME_LEN];
+		DisplayConfig config;
+	};
+
+	// Guarded by configMutex. The active preset is the published config.
+	Preset presets[ConfigManager::MAX_PRESETS] = {};
+	int activePreset = 0;
+
+	// The writer commits once saves have been quiet for WRITE_QUIET_MS, but
+	// no later than WRITE_DEADLINE_MS after the first unwritten save
+	const uint32_t WRITE_QUIET_MS = 2000;
+	const uint32_t WRITE_DEADLINE_MS = 10000;
+
+	TaskHandle_t writerTask = nullptr;
+
+	// Serializes NVS writes between the writer task and flush() callers
+	SemaphoreHandle_t persistMutex = nullptr;
+
+	// Guarded by configMutex. A dirty preset is written, or erased if no
+	// longer used; the active preset id is its own small NVS entry
+	uint8_t dirtyPresets = 0;
+	bool activeDirty = false;
+	TickType_t firstUnwrittenTick = 0;
+	TickType_t lastSaveTick = 0;
+	ConfigManager::PersistStats persistStats = {};
+
+	bool isReclaimable(const RecordSlot& slot)
+	{
+		uint32_t retiredAt = slot.retiredAt.load();
+		if (retiredAt == RECORD_PUBLISHED || retiredAt == RECORD_RESERVED)
+			return false;
+
+		for (int i = 0; i < readerCount.load(); i++)
+		{
+			uint32_t epoch = readerEpochs[i].load();
+			if (epoch != READER_OFFLINE && epoch < retiredAt)
+				return false;
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Claim a free record for the next publication
+	 *
+	 * Called before taking configMutex, so waiting for readers never opens
+	 * a window in the middle of a publication. Readers leave records
+	 * within a frame, so a grace period is short.
+	 */
+	RecordSlot& reserveRecord()
+	{
+		for (;;)
+		{
+			for (RecordSlot& slot : records)
+			{
+				uint32_t retiredAt = slot.retiredAt.load();
+				if (isReclaimable(slot) && slot.retiredAt.compare_exchange_strong(retiredAt, RECORD_RESERVED))
+					return slot;
+			}
+			vTaskDelay(pdMS_TO_TICKS(10));
+		}
+	}
+
+	// Hand back a reserved record that was not published; no reader has seen it
+	void releaseRecord(RecordSlot& slot)
+	{
+		slot.retiredAt = 0;
+	}
+
+	// Called with configMutex held
+	void publish(RecordSlot& slot, const DisplayConfig& config, uint32_t version)
+	{
+		slot.record.config = config;
+		slot.record.version = version;
+		slot.retiredAt = RECORD_PUBLISHED;
+
+		const ConfigRecord* previous = published.exchange(&slot.record);
+		configVersion = version;
+
+		if (previous != nullptr)
+		{
+			for (RecordSlot& old : records)
+			{
+				if (&old.record == previous)
+					old.retiredAt = version;
+			}
+		}
+	}
+
+	/**
+	 * @brief Publish a config as the next version in a reserved record
+	 *
+	 * Called with configMutex held, which it never releases, so versions
+	 * follow the order of the changes they publish.
+	 */
+	uint32_t publishNext(RecordSlot& slot, const DisplayConfig& config)
+	{
+		uint32_t version = configVersion.load() + 1;
+		publish(slot, config, version);
+		return version;
+	}
+
+	void notifyListeners(uint32_t version)
+	{
+		for (int i = 0; i < listenerCount; i++)
+		{
+			listeners[i].callback(version, listeners[i].ctx);
+		}
+	}
+
+	bool hasUnwritten()
+	{
+		return dirtyPresets != 0 || activeDirty;
+	}
+
+	// Called with configMutex held
+	void markUnwritten(uint8_t presetMask, bool active)
+	{
+		TickType_t now = xTaskGetTickCount();
+		if (hasUnwritten())
+		{
+			persistStats.coalesced++;
+		}
+		else
+		{
+			firstUnwrittenTick = now;
+		}
+		dirtyPresets |= presetMask;
+		activeDirty |= active;
+		lastSaveTick = now;
+		persistStats.saves++;
+	}
+
+	void presetKey(int id, char* key, size_t size)
+	{
+		snprintf(key, size, PRESET_KEY_FORMAT, id);
+	}
+
+	void copyField(char* dest, size_t size, const char* src)
+	{
+		strncpy(dest, src, size - 1);
+		dest[size - 1] = '\0';
+	}
+
+	void encodeBlob(const DisplayConfig& config, const char* name, ConfigBlob& blob)
+	{
+		memset(&blob, 0, sizeof(blob));
+		ConfigBlobPayload& payload = blob.payload;
+
+		payload.flags = (config.showClock ? FLAG_CLOCK : 0) |
+		                (config.showWeather ? FLAG_WEATHER : 0) |
+		                (config.showForecast ? FLAG_FORECAST : 0) |
+		                (config.showStarWarsQuotes ? FLAG_STAR_WARS : 0) |
+		                (config.showLOTRQuotes ? FLAG_LOTR : 0) |
+		                (config.displayFlipped ? FLAG_FLIPPED : 0);
+		payload.brightness = config.brightness;
+		payload.nightStartHour = config.nightStartHour;
+		payload.nightEndHour = config.nightEndHour;
+		copyField(payload.customText, sizeof(payload.customText), config.customText);
+		copyField(payload.weatherApiKey, sizeof(payload.weatherApiKey), config.weatherApiKey);
+		payload.weatherLocationCount = config.weatherLocationCount;
+		for (int i = 0; i < config.weatherLocationCount; i++)
+		{
+			copyField(payload.weatherLocations[i], sizeof(payload.weatherLocations[i]), config.weatherLocations[i]);
+		}
+		copyField(payload.presetName, sizeof(payload.presetName), name);
+
+		blob.header.schema = CONFIG_SCHEMA;
+		blob.header.length = sizeof(payload);
+		blob.header.crc = esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&payload), sizeof(payload));
+	}
+
+	void decodePayload(const ConfigBlobPayload& payload, DisplayConfig& config, char* name)
+	{
+		config.showClock = payload.flags & FLAG_CLOCK;
+		config.showWeather = payload.flags & FLAG_WEATHER;
+		config.showForecast = payload.flags & FLAG_FORECAST;
+		config.showStarWarsQuotes = payload.flags & FLAG_STAR_WARS;
+		config.showLOTRQuotes = payload.flags & FLAG_LOTR;
+		config.displayFlipped = payload.flags & FLAG_FLIPPED;
+		config.brightness = payload.brightness <= 15 ? payload.brightness : 8;
+		config.nightStartHour = payload.nightStartHour < 24 ? payload.nightStartHour : 0;
+		config.nightEndHour = payload.nightEndHour < 24 ? payload.nightEndHour : 0;
+		copyField(config.customText, sizeof(config.customText), payload.customText);
+		copyField(config.weatherApiKey, sizeof(config.weatherApiKey), payload.weatherApiKey);
+
+		char locations[DisplayConfig::MAX_WEATHER_LOCATIONS][DisplayConfig::WEATHER_LOCATION_LEN];
+		const char* entries[DisplayConfig::MAX_WEATHER_LOCATIONS];
+		int count = payload.weatherLocationCount;
+		if (count > DisplayConfig::MAX_WEATHER_LOCATIONS)
+			count = DisplayConfig::MAX_WEATHER_LOCATIONS;
+		for (int i = 0; i < count; i++)
+		{
+			copyField(locations[i], sizeof(locations[i]), payload.weatherLocations[i]);
+			entries[i] = locations[i];
+		}
+		ConfigManager::setWeatherLocations(config, entries, count);
+
+		copyField(name, ConfigManager::PRESET_NAME_LEN, payload.presetName);
+	}
+
+	/**
+	 * @brief Read and verify a config blob
+	 *
+	 * @return ESP_OK, ESP_ERR_NVS_NOT_FOUND if there is none, or
+	 *         ESP_ERR_INVALID_CRC / ESP_ERR_INVALID_VERSION / ESP_ERR_INVALID_SIZE
+	 */
+	esp_err_t readBlob(nvs_handle_t nvsHandle, const char* key, DisplayConfig& config, char* name)
+	{
+		ConfigBlob blob;
+		size_t size = sizeof(blob);
+		esp_err_t err = nvs_get_blob(nvsHandle, key, &blob, &size);
+		if (err == ESP_ERR_NVS_INVALID_LENGTH)
+			return ESP_ERR_INVALID_VERSION;   // Written by a newer schema
+		if (err != ESP_OK)
+			return err;
+
+		const ConfigBlobHeader& header = blob.header;
+		if (size < sizeof(header) || header.length != size - sizeof(header))
+			return ESP_ERR_INVALID_SIZE;
+		if (header.schema == 0 || header.schema > CONFIG_SCHEMA)
+			return ESP_ERR_INVALID_VERSION;
+		// Only older schemas may be shorter; their missing tail is filled
+		// from the defaults below
+		if (header.schema == CONFIG_SCHEMA ? header.length != sizeof(ConfigBlobPayload)
+		                                   : header.length > sizeof(ConfigBlobPayload))
+			return ESP_ERR_INVALID_SIZE;
+		if (esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&blob.payload), header.length) != header.crc)
+			return ESP_ERR_INVALID_CRC;
+
+		// Older schemas stop early; fields they lack keep their defaults
+		if (header.schema < CONFIG_SCHEMA)
+		{
+			ConfigBlob defaults;
+			DisplayConfig defaultConfig;
+			ConfigManager::getDefaultConfig(defaultConfig);
+			encodeBlob(defaultConfig, "", defaults);
+			memcpy(&defaults.payload, &blob.payload, header.length);
+			blob.payload = defaults.payload;
+		}
+
+		decodePayload(blob.payload, config, name);
+		return ESP_OK;
+	}
+
+	/**
+	 * @brief Read the pre-blob per-key layout
+	 *
+	 * Missing keys keep the defaults the caller put in config.
+	 *
+	 * @return true if any legacy key was present
+	 */
+	bool readLegacyKeys(nvs_handle_t nvsHandle, DisplayConfig& config)
+	{
+		bool found = false;
+		uint8_t val;
+
+		struct FlagKey
+		{
+			const char* key;
+			bool DisplayConfig::*field;
+		};
+		const FlagKey flagKeys[] = {
+			{"show_clock", &DisplayConfig::showClock},
+			{"show_weather", &DisplayConfig::showWeather},
+			{"show_forecast", &DisplayConfig::showForecast},
+			{"show_sw", &DisplayConfig::showStarWarsQuotes},
+			{"show_lotr", &DisplayConfig::showLOTRQuotes},
+			{"flip_display", &DisplayConfig::displayFlipped},
+		};
+		for (const FlagKey& flag : flagKeys)
+		{
+			if (nvs_get_u8(nvsHandle, flag.key, &val) == ESP_OK)
+			{
+				config.*flag.field = val != 0;
+				found = true;
+			}
+		}
+
+		if (nvs_get_u8(nvsHandle, "brightness", &val) == ESP_OK)
+		{
+			config.brightness = val;
+			found = true;
+		}
+		if (nvs_get_u8(nvsHandle, "night_start", &val) == ESP_OK)
+		{
+			config.nightStartHour = val < 24 ? val : 0;
+			found = true;
+		}
+		if (nvs_get_u8(nvsHandle, "night_end", &val) == ESP_OK)
+		{
+			config.nightEndHour = val < 24 ? val : 0;
+			found = true;
+		}
+
+		// nvs_get_str leaves the default in place when the key is missing
+		size_t textLen = sizeof(config.customText);
+		if (nvs_get_str(nvsHandle, "custom_text", config.customText, &textLen) == ESP_OK)
+			found = true;
+
+		size_t apiKeyLen = sizeof(config.weatherApiKey);
+		if (nvs_get_str(nvsHandle, "api_key", config.weatherApiKey, &apiKeyLen) == ESP_OK)
+			found = true;
+
+		char locations[LOCATIONS_STR_LEN];
+		size_t locationsLen = sizeof(locations);
+		if (nvs_get_str(nvsHandle, "weather_locs", locations, &locationsLen) == ESP_OK)
+			found = true;
+		else
+			locations[0] = '\0';
+
+		const char* entries[DisplayConfig::MAX_WEATHER_LOCATIONS];
+		int entryCount = 0;
+		char* saveptr = nullptr;
+		const char separators[] = {LOCATION_SEPARATOR, '\0'};
+		for (char* entry = strtok_r(locations, separators, &saveptr);
+		     entry != nullptr && entryCount < DisplayConfig::MAX_WEATHER_LOCATIONS;
+		     entry = strtok_r(nullptr, separators, &saveptr))
+		{
+			entries[entryCount++] = entry;
+		}
+		ConfigManager::setWeatherLocations(config, entries, entryCount);
+
+		return found;
+	}
+
+	void eraseLegacyKeys(nvs_handle_t nvsHandle)
+	{
+		for (const char* key : LEGACY_KEYS)
+		{
+			nvs_erase_key(nvsHandle, key);
+		}
+		nvs_erase_key(nvsHandle, LEGACY_BLOB_KEY);
+		nvs_commit(nvsHandle);
+	}
 }
 
 void ConfigManager::init()
 {
 	// NVS should already be initialized by WifiManager
+	configMutex = xSemaphoreCreateMutex();
+
+	persistMutex = xSemaphoreCreateMutex();
+
+	loadFromNvs();
+	publish(records[0], presets[activePreset].config, configVersion.load());
+
+	if (xTaskCreate(writerTaskMain, "config_wr", 3072, nullptr, 2, &writerTask) != pdPASS)
+	{
+		ESP_LOGE(TAG, "Cannot start config writer; saves will write through");
+		writerTask = nullptr;
+	}
+	esp_register_shutdown_handler(onShutdown);
 }
 
 bool ConfigManager::saveConfig(const DisplayConfig& config)
 {
-	nvs_handle_t nvsHandle;
-	esp_err_t err;
+	RecordSlot& slot = reserveRecord();
+	xSemaphoreTake(configMutex, portMAX_DELAY);
+	presets[activePreset].config = config;
+	uint32_t version = publishNext(slot, config);
+	markUnwritten(1 << activePreset, false);
+	xSemaphoreGive(configMutex);
 
-	err = nvs_open("storage", NVS_READWRITE, &nvsHandle);
-	if (err != ESP_OK)
+	notifyListeners(version);
+	return scheduleWrite();
+}
+
+int ConfigManager::getActivePreset()
+{
+	xSemaphoreTake(configMutex, portMAX_DELAY);
+	int id = activePreset;
+	xSemaphoreGive(configMutex);
+	return id;
+}
+
+void ConfigManager::getPresets(PresetInfo* info)
+{
+	xSemaphoreTake(configMutex, portMAX_DELAY);
+	for (int i = 0; i < MAX_PRESETS; i++)
 	{
-		ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
+		info[i].used = presets[i].used;
+		memcpy(info[i].name, presets[i].name, sizeof(info[i].name));
+	}
+	xSemaphoreGive(configMutex);
+}
+
+bool ConfigManager::getPreset(int id, DisplayConfig& config)
+{
+	if (id < 0 || id >= MAX_PRESETS)
 		return false;
+
+	xSemaphoreTake(configMutex, portMAX_DELAY);
+	bool used = presets[id].used;
+	if (used)
+	{
+		config = presets[id].config;
 	}
+	xSemaphoreGive(configMutex);
+	return used;
+}
+
+bool ConfigManager::savePreset(int id, const char* name, const DisplayConfig& config)
+{
+	if (id < 0 || id >= MAX_PRESETS || name == nullptr || name[0] == '\0')
+		return false;
 
-	err = nvs_set_u8(nvsHandle, "show_clock", config.showClock ? 1 : 0);
-	if (err != ESP_OK) goto error;
+	// Whether the preset is active is only known under the mutex
+	RecordSlot& slot = reserveRecord();
+	xSemaphoreTake(configMutex, portMAX_DELAY);
+	Preset& preset = presets[id];
+	preset.used = true;
+	copyField(preset.name, sizeof(preset.name), name);
+	preset.config = config;
 
-	err = nvs_set_u8(nvsHandle, "show_weather", config.showWeather ? 1 : 0);
-	if (err != ESP_OK) goto error;
+	uint32_t version = 0;
+	if (id == activePreset)
+	{
+		version = publishNext(slot, config);
+	}
+	else
+	{
+		releaseRecord(slot);
+	}
+	markUnwritten(1 << id, false);
+	xSemaphoreGive(configMutex);
 
-	err = nvs_set_u8(nvsHandle, "show_sw", config.showStarWarsQuotes ? 1 : 0);
-	if (err != ESP_OK) goto error;
+	if (version != 0)
+	{
+		notifyListeners(version);
+	}
+	return scheduleWrite();
+}
 
-	err = nvs_set_u8(nvsHandle, "show_lotr", config.showLOTRQuotes ? 1 : 0);
-	if (err != ESP_OK) goto error;
+bool ConfigManager::activatePreset(int id)
+{
+	if (id < 0 || id >= MAX_PRESETS)
+		return false;
 
-	err = nvs_set_u8(nvsHandle, "flip_display", config.displayFlipped ? 1 : 0);
-	if (err != ESP_OK) goto error;
+	// The preset is already in RAM, so switching publishes it as is and
+	// only the active id is written to flash
+	RecordSlot& slot = reserveRecord();
+	xSemaphoreTake(configMutex, portMAX_DELAY);
+	if (!presets[id].used || id == activePreset)
+	{
+		bool active = id == activePreset;
+		releaseRecord(slot);
+		xSemaphoreGive(configMutex);
+		return active;
+	}
+	activePreset = id;
+	uint32_t version = publishNext(slot, presets[id].config);
+	markUnwritten(0, true);
+	xSemaphoreGive(configMutex);
 
-	err = nvs_set_u8(nvsHandle, "brightness", config.brightness);
-	if (err != ESP_OK) goto error;
+	ESP_LOGI(TAG, "Switched to preset %d", id);
+	notifyListeners(version);
+	return scheduleWrite();
+}
 
-	err = nvs_set_str(nvsHandle, "custom_text", config.customText);
-	if (err != ESP_OK) goto error;
+bool ConfigManager::deletePreset(int id)
+{
+	if (id < 0 || id >= MAX_PRESETS)
+		return false;
 
-	err = nvs_set_str(nvsHandle, "api_key", config.weatherApiKey);
-	if (err != ESP_OK) goto error;
+	xSemaphoreTake(configMutex, portMAX_DELAY);
+	// The active preset is the live config and cannot go away
+	bool deletable = presets[id].used && id != activePreset;
+	if (deletable)
+	{
+		presets[id].used = false;
+		markUnwritten(1 << id, false);
+	}
+	xSemaphoreGive(configMutex);
 
-	err = nvs_commit(nvsHandle);
-	if (err != ESP_OK) goto error;
+	return deletable && scheduleWrite();
+}
 
-	nvs_close(nvsHandle);
-	ESP_LOGI(TAG, "Display config saved successfully");
-	return true;
+bool ConfigManager::scheduleWrite()
+{
+	if (writerTask == nullptr)
+		return flush();
 
-error:
-	ESP_LOGE(TAG, "Error saving config: %s", esp_err_to_name(err));
-	nvs_close(nvsHandle);
-	return false;
+	xTaskNotifyGive(writerTask);
+	return true;
 }
 
-bool ConfigManager::loadConfig(DisplayConfig& config)
+bool ConfigManager::flush()
 {
+	xSemaphoreTake(persistMutex, portMAX_DELAY);
+
+	// Later changes mark themselves again and get their own write
+	xSemaphoreTake(configMutex, portMAX_DELAY);
+	uint8_t dirty = dirtyPresets;
+	bool active = activeDirty;
+	uint8_t activeId = activePreset;
+	dirtyPresets = 0;
+	activeDirty = false;
+	xSemaphoreGive(configMutex);
+
+	if (dirty == 0 && !active)
+	{
+		xSemaphoreGive(persistMutex);
+		return true;
+	}
+
+	int64_t startUs = esp_timer_get_time();
 	nvs_handle_t nvsHandle;
-	esp_err_t err;
+	esp_err_t err = nvs_open("storage", NVS_READWRITE, &nvsHandle);
+	if (err == ESP_OK)
+	{
+		for (int i = 0; i < MAX_PRESETS && err == ESP_OK; i++)
+		{
+			if (!(dirty & (1 << i)))
+				continue;
+
+			// One preset at a time keeps the writer's stack small
+			ConfigBlob blob;
+			xSemaphoreTake(configMutex, portMAX_DELAY);
+			bool used = presets[i].used;
+			if (used)
+			{
+				encodeBlob(presets[i].config, presets[i].name, blob);
+			}
+			xSemaphoreGive(configMutex);
+
+			char key[16];
+			presetKey(i, key, sizeof(key));
+			if (used)
+			{
+				err = nvs_set_blob(nvsHandle, key, &blob, sizeof(blob));
+			}
+			else
+			{
+				err = nvs_erase_key(nvsHandle, key);
+				if (err == ESP_ERR_NVS_NOT_FOUND)
+					err = ESP_OK;
+			}
+		}
+
+		if (err == ESP_OK && active)
+		{
+			err = nvs_set_u8(nvsHandle, ACTIVE_PRESET_KEY, activeId);
+		}
+		if (err == ESP_OK)
+		{
+			err = nvs_commit(nvsHandle);
+		}
+		nvs_close(nvsHandle);
+	}
+	uint32_t elapsedUs = esp_timer_get_time() - startUs;
+
+	xSemaphoreTake(configMutex, portMAX_DELAY);
+	if (err == ESP_OK)
+	{
+		persistStats.commits++;
+		persistStats.lastCommitUs = elapsedUs;
+	}
+	else
+	{
+		// Retried by the writer after another quiet period
+		persistStats.failures++;
+		if (!hasUnwritten())
+		{
+			firstUnwrittenTick = xTaskGetTickCount();
+		}
+		dirtyPresets |= dirty;
+		activeDirty |= active;
+	}
+	xSemaphoreGive(configMutex);
+	xSemaphoreGive(persistMutex);
 
-	err = nvs_open("storage", NVS_READONLY, &nvsHandle);
 	if (err != ESP_OK)
 	{
-		ESP_LOGW(TAG, "Error opening NVS handle, using defaults: %s", esp_err_to_name(err));
-		getDefaultConfig(config);
+		ESP_LOGE(TAG, "Error saving config: %s", esp_err_to_name(err));
 		return false;
 	}
+	ESP_LOGI(TAG, "Config saved (presets 0x%x%s in %lu us)",
+	         dirty, active ? ", active id" : "", (unsigned long)elapsedUs);
+	return true;
+}
+
+void ConfigManager::getPersistStats(PersistStats& stats)
+{
+	xSemaphoreTake(configMutex, portMAX_DELAY);
+	stats = persistStats;
+	stats.pending = hasUnwritten();
+	xSemaphoreGive(configMutex);
+}
 
-	uint8_t val;
-	err = nvs_get_u8(nvsHandle, "show_clock", &val);
-	config.showClock = (err == ESP_OK) ? (val != 0) : true;
+void ConfigManager::writerTaskMain(void* arg)
+{
+	const TickType_t quiet = pdMS_TO_TICKS(WRITE_QUIET_MS);
+	const TickType_t deadline = pdMS_TO_TICKS(WRITE_DEADLINE_MS);
+	TickType_t wait = portMAX_DELAY;
 
-	err = nvs_get_u8(nvsHandle, "show_weather", &val);
-	config.showWeather = (err == ESP_OK) ? (val != 0) : false;
+	for (;;)
+	{
+		// Woken by every save; otherwise sleeps until the next due time
+		ulTaskNotifyTake(pdTRUE, wait);
 
-	err = nvs_get_u8(nvsHandle, "show_sw", &val);
-	config.showStarWarsQuotes = (err == ESP_OK) ? (val != 0) : false;
+		xSemaphoreTake(configMutex, portMAX_DELAY);
+		bool pending = hasUnwritten();
+		TickType_t now = xTaskGetTickCount();
+		TickType_t sinceSave = now - lastSaveTick;
+		TickType_t sinceFirst = now - firstUnwrittenTick;
+		xSemaphoreGive(configMutex);
 
-	err = nvs_get_u8(nvsHandle, "show_lotr", &val);
-	config.showLOTRQuotes = (err == ESP_OK) ? (val != 0) : false;
+		if (!pending)
+		{
+			wait = portMAX_DELAY;
+			continue;
+		}
 
-	err = nvs_get_u8(nvsHandle, "flip_display", &val);
-	config.displayFlipped = (err == ESP_OK) ? (val != 0) : false;
+		if (sinceSave < quiet && sinceFirst < deadline)
+		{
+			TickType_t untilQuiet = quiet - sinceSave;
+			TickType_t untilDeadline = deadline - sinceFirst;
+			wait = untilQuiet < untilDeadline ? untilQuiet : untilDeadline;
+			continue;
+		}
 
-	err = nvs_get_u8(nvsHandle, "brightness", &val);
-	config.brightness = (err == ESP_OK) ? val : 8;
+		// A save during the write notifies us again, so nothing is missed
+		wait = flush() ? portMAX_DELAY : quiet;
+	}
+}
 
-	size_t textLen = sizeof(config.customText);
-	err = nvs_get_str(nvsHandle, "custom_text", config.customText, &textLen);
-	if (err != ESP_OK)
+void ConfigManager::onShutdown()
+{
+	flush();
+}
+
+uint32_t ConfigManager::getConfig(DisplayConfig& config)
+{
+	// Records are only reclaimed under the mutex, so this copy is safe
+	// without a reader registration
+	xSemaphoreTake(configMutex, portMAX_DELAY);
+	const ConfigRecord* record = published.load();
+	config = record->config;
+	uint32_t version = record->version;
+	xSemaphoreGive(configMutex);
+	return version;
+}
+
+const ConfigRecord* ConfigManager::read()
+{
+	return published.load(std::memory_order_acquire);
+}
+
+int ConfigManager::registerReader()
+{
+	int reader = readerCount.load();
+	if (reader >= MAX_READERS)
+	{
+		ESP_LOGE(TAG, "Cannot register config reader");
+		return -1;
+	}
+
+	readerEpochs[reader] = READER_OFFLINE;
+	readerCount = reader + 1;
+	return reader;
+}
+
+void ConfigManager::quiescent(int reader)
+{
+	if (reader >= 0)
+	{
+		readerEpochs[reader] = configVersion.load();
+	}
+}
+
+void ConfigManager::offline(int reader)
+{
+	if (reader >= 0)
 	{
-		config.customText[0] = '\0';
+		readerEpochs[reader] = READER_OFFLINE;
 	}
+}
 
-	size_t apiKeyLen = sizeof(config.weatherApiKey);
-	err = nvs_get_str(nvsHandle, "api_key", config.weatherApiKey, &apiKeyLen);
+void ConfigManager::loadFromNvs()
+{
+	for (Preset& preset : presets)
+	{
+		preset.used = false;
+		getDefaultConfig(preset.config);
+	}
+	activePreset = 0;
+
+	nvs_handle_t nvsHandle;
+	esp_err_t err = nvs_open("storage", NVS_READWRITE, &nvsHandle);
 	if (err != ESP_OK)
 	{
-		// Fallback to Kconfig value if not in NVS
-		strncpy(config.weatherApiKey, CONFIG_OPENWEATHER_API_KEY, sizeof(config.weatherApiKey) - 1);
-		config.weatherApiKey[sizeof(config.weatherApiKey) - 1] = '\0';
+		ESP_LOGW(TAG, "Error opening NVS handle, using defaults: %s", esp_err_to_name(err));
+		presets[0].used = true;
+		return;
+	}
+
+	int64_t startUs = esp_timer_get_time();
+	int presetCount = 0;
+	for (int i = 0; i < MAX_PRESETS; i++)
+	{
+		char key[16];
+		presetKey(i, key, sizeof(key));
+		err = readBlob(nvsHandle, key, presets[i].config, presets[i].name);
+		if (err == ESP_OK)
+		{
+			presets[i].used = true;
+			presetCount++;
+		}
+		else
+		{
+			getDefaultConfig(presets[i].config);
+			if (err != ESP_ERR_NVS_NOT_FOUND)
+			{
+				// Keep the unreadable blob; the next save of this preset replaces it
+				ESP_LOGW(TAG, "Preset %d unusable: %s", i, esp_err_to_name(err));
+			}
+		}
+	}
+
+	if (presetCount > 0)
+	{
+		uint8_t id;
+		if (nvs_get_u8(nvsHandle, ACTIVE_PRESET_KEY, &id) == ESP_OK && id < MAX_PRESETS && presets[id].used)
+		{
+			activePreset = id;
+		}
+		else
+		{
+			while (!presets[activePreset].used)
+				activePreset++;
+		}
+		ESP_LOGI(TAG, "Loaded %d presets in %lld us, preset %d active", presetCount,
+		         (long long)(esp_timer_get_time() - startUs), activePreset);
+		nvs_close(nvsHandle);
+		return;
+	}
+
+	// No presets yet: the single-config blob, or before that one key per
+	// field, becomes preset 0
+	Preset& preset = presets[0];
+	preset.used = true;
+	err = readBlob(nvsHandle, LEGACY_BLOB_KEY, preset.config, preset.name);
+	bool migrated = err == ESP_OK;
+	if (!migrated)
+	{
+		getDefaultConfig(preset.config);
+		migrated = readLegacyKeys(nvsHandle, preset.config);
+	}
+	copyField(preset.name, sizeof(preset.name), MIGRATED_PRESET_NAME);
+
+	if (migrated)
+	{
+		// Drop the old entries only once the preset is safely committed
+		ConfigBlob blob;
+		encodeBlob(preset.config, preset.name, blob);
+		char key[16];
+		presetKey(0, key, sizeof(key));
+		err = nvs_set_blob(nvsHandle, key, &blob, sizeof(blob));
+		if (err == ESP_OK)
+		{
+			err = nvs_set_u8(nvsHandle, ACTIVE_PRESET_KEY, 0);
+		}
+		if (err == ESP_OK)
+		{
+			err = nvs_commit(nvsHandle);
+		}
+
+		if (err == ESP_OK)
+		{
+			eraseLegacyKeys(nvsHandle);
+			ESP_LOGI(TAG, "Migrated stored config to preset 0 (schema %u)", CONFIG_SCHEMA);
+		}
+		else
+		{
+			ESP_LOGE(TAG, "Error migrating config: %s", esp_err_to_name(err));
+		}
 	}
 
 	nvs_close(nvsHandle);
+}
+
+uint32_t ConfigManager::getVersion()
+{
+	return configVersion.load();
+}
+
+bool ConfigManager::addChangeListener(ChangeCallback callback, void* ctx)
+{
+	if (callback == nullptr || listenerCount >= MAX_CHANGE_LISTENERS)
+	{
+		ESP_LOGE(TAG, "Cannot register config change listener");
+		return false;
+	}
+
+	listeners[listenerCount].callback = callback;
+	listeners[listenerCount].ctx = ctx;
+	listenerCount++;
 	return true;
 }
 
+void ConfigManager::setWeatherLocations(DisplayConfig& config, const char* const* locations, int count)
+{
+	config.weatherLocationCount = 0;
+
+	for (int i = 0; i < count && config.weatherLocationCount < DisplayConfig::MAX_WEATHER_LOCATIONS; i++)
+	{
+		const char* start = locations[i];
+		while (*start == ' ' || *start == '\t' || *start == '\r')
+			start++;
+
+		size_t len = strlen(start);
+		while (len > 0 && (start[len - 1] == ' ' || start[len - 1] == '\t' || start[len - 1] == '\r'))
+			len--;
+
+		if (len == 0)
+			continue;
+		if (len >= DisplayConfig::WEATHER_LOCATION_LEN)
+			len = DisplayConfig::WEATHER_LOCATION_LEN - 1;
+
+		char* dest = config.weatherLocations[config.weatherLocationCount++];
+		memcpy(dest, start, len);
+		dest[len] = '\0';
+	}
+
+	if (config.weatherLocationCount == 0)
+	{
+		snprintf(config.weatherLocations[0], sizeof(config.weatherLocations[0]), "%s,%s",
+		         CONFIG_WEATHER_CITY, CONFIG_WEATHER_COUNTRY_CODE);
+		config.weatherLocationCount = 1;
+	}
+}
+
 void ConfigManager::getDefaultConfig(DisplayConfig& config)
 {
 	config.showClock = true;
 	config.showWeather = false;
+	config.showForecast = false;
 	config.showStarWarsQuotes = false;
 	config.showLOTRQuotes = false;
 	config.displayFlipped = false;
 	config.brightness = 8;
+	config.nightStartHour = 0;
+	config.nightEndHour = 0;
 	config.customText[0] = '\0';
 	strncpy(config.weatherApiKey, CONFIG_OPENWEATHER_API_KEY, sizeof(config.weatherApiKey) - 1);
 	config.weatherApiKey[sizeof(config.weatherApiKey) - 1] = '\0';
+	setWeatherLocations(config, nullptr, 0);
 }
@@ -3,6 +3,10 @@
 #include "Quotes.hpp"
 #include "esp_log.h"
 #include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <sys/time.h>
+#include <atomic>
 #include <cstring>
 
 namespace
@@ -10,156 +14,645 @@ namespace
 	const char* TAG = "DisplayController";
 }
 
-#define WEATHER_UPDATE_INTERVAL_MS (60 * 60 * 1000)  // 1 hour
-#define MODE_SWITCH_INTERVAL_MS (10 * 1000)  // 10 seconds per mode
+#define CLOCK_DURATION_MS (10 * 1000)  // time on the clock per playlist cycle
+#define SCROLL_FRAME_MS 50  // one column per frame
+#define CLOCK_UNSYNCED_POLL_MS 1000  // re-check time sync while showing "--:--"
+#define IDLE_MESSAGE_PAUSE_MS 5000  // pause between "configure me" scrolls
+#define NIGHT_MAX_SLEEP_MS (5 * 60 * 1000)  // re-check at least this often while blanked
+#define DUTY_WINDOW_US (60 * 1000 * 1000LL)  // duty cycle reporting window
+#define CONTENT_TEXT_LEN 192  // formatted weather or forecast, with location label
+#define PREFETCH_CORE (portNUM_PROCESSORS - 1)  // the display task runs on core 0
+
+namespace
+{
+	TaskHandle_t displayTask = nullptr;
+	std::atomic<uint32_t> dutyCyclePermille{0};
+
+	/**
+	 * Prefetch handoff between the display task and the prefetch task.
+	 * Request n is answered in slot n % 2; two slots suffice because only
+	 * the item on screen and the one after it are ever prepared, and the
+	 * next request for a slot is only posted once its item is over. The
+	 * request is one atomic word (sequence << 32 | kind << 8 | location),
+	 * so it is never read torn. The prefetch task stores readySequence
+	 * with release once the strip is complete; a display task acquire load
+	 * that sees its sequence there also sees the pixels.
+	 */
+	struct PrefetchSlot
+	{
+		DisplayManager::TextStrip strip;
+		uint32_t configVersion;
+		std::atomic<uint32_t> readySequence{0};
+	};
+
+	PrefetchSlot prefetchSlots[2];
+	std::atomic<uint64_t> prefetchRequest{0};
+	TaskHandle_t prefetchTask = nullptr;
+	int prefetchReader = -1;
+
+	uint32_t msUntilNextMinute()
+	{
+		struct timeval tv;
+		gettimeofday(&tv, nullptr);
+		uint32_t msIntoMinute = (tv.tv_sec % 60) * 1000 + tv.tv_usec / 1000;
+		// Land just after the boundary so the new minute is already visible
+		return 60 * 1000 - msIntoMinute + 5;
+	}
+
+	/**
+	 * How long each kind of content stays up; indexed by ContentKind.
+	 * 0 plays exactly one scroll pass. A timed scrolling item repeats its
+	 * pass until the time is up, but a pass is never cut short.
+	 */
+	const uint32_t CONTENT_DURATION_MS[] = {
+		CLOCK_DURATION_MS,  // Clock
+		0,                  // Weather
+		0,                  // Forecast
+		0,                  // StarWarsQuote
+		0,                  // LotrQuote
+		0,                  // CustomText
+	};
+
+	// Slots per playlist cycle, or 0 if the content is disabled
+	uint8_t contentWeight(DisplayController::ContentKind kind, const DisplayConfig& config)
+	{
+		using Kind = DisplayController::ContentKind;
+		switch (kind)
+		{
+		// Each slot shows the next location, so every location gets a turn per cycle
+		case Kind::Weather: return config.showWeather ? config.weatherLocationCount : 0;
+		case Kind::Forecast: return config.showForecast ? config.weatherLocationCount : 0;
+		case Kind::Clock: return config.showClock ? 1 : 0;
+		case Kind::StarWarsQuote: return config.showStarWarsQuotes ? 1 : 0;
+		case Kind::LotrQuote: return config.showLOTRQuotes ? 1 : 0;
+		case Kind::CustomText: return config.customText[0] != '\0' ? 1 : 0;
+		default: return 0;
+		}
+	}
+
+	// "City: " label from a "City,CC" query, used when rotating locations
+	size_t writeLocationLabel(const char* location, char* buffer, size_t size)
+	{
+		size_t cityLen = strcspn(location, ",");
+		int len = snprintf(buffer, size, "%.*s: ", static_cast<int>(cityLen), location);
+		return (len < 0 || static_cast<size_t>(len) >= size) ? 0 : len;
+	}
+
+	/**
+	 * Text of a scrolling item. Runs on either task, so it only reads
+	 * @p config and thread-safe sources. The result may point into the
+	 * config or the quote table instead of @p buffer.
+	 */
+	const char* formatContent(DisplayController::ContentKind kind, uint8_t location, const DisplayConfig& config,
+	                          char* buffer, size_t size)
+	{
+		using Kind = DisplayController::ContentKind;
+		switch (kind)
+		{
+		case Kind::StarWarsQuote: return Quotes::getStarWarsQuote();
+		case Kind::LotrQuote: return Quotes::getLOTRQuote();
+		case Kind::CustomText: return config.customText;
+		case Kind::Weather:
+		case Kind::Forecast:
+			break;
+		default: return "";
+		}
+
+		if (config.weatherLocationCount == 0)
+			return "";
+
+		const char* query = config.weatherLocations[location % config.weatherLocationCount];
+		size_t labelLen = (config.weatherLocationCount > 1) ? writeLocationLabel(query, buffer, size) : 0;
+		if (kind == Kind::Weather)
+		{
+			WeatherData weather;
+			WeatherFetcher::getLatest(query, weather);
+			WeatherFetcher::formatWeatherString(weather, buffer + labelLen, size - labelLen);
+		}
+		else
+		{
+			ForecastData forecast;
+			WeatherFetcher::getForecast(query, forecast);
+			WeatherFetcher::formatForecastString(forecast, buffer + labelLen, size - labelLen);
+		}
+		return buffer;
+	}
+}
 
 DisplayController::DisplayController(DisplayManager* display)
 	: m_display(display)
-	, m_lastWeatherUpdate(0)
-	, m_currentMode(0)
-	, m_lastModeSwitch(0)
 {
-	ConfigManager::loadConfig(m_config);
-	memset(&m_weatherData, 0, sizeof(m_weatherData));
+	m_configVersion = ConfigManager::getConfig(m_config);
+	compilePlaylist();
 }
 
 void DisplayController::start()
 {
 	ESP_LOGI(TAG, "Display controller started");
 
-	// Initial weather fetch
-	if (m_config.showWeather)
+	displayTask = xTaskGetCurrentTaskHandle();
+	m_dutyWindowStartUs = esp_timer_get_time();
+	m_configReader = ConfigManager::registerReader();
+	ConfigManager::addChangeListener(onConfigChanged, nullptr);
+	MessageQueue::setArrivalListener(onMessageQueued, nullptr);
+
+	// Without the prefetch task every item is prepared when it starts
+	prefetchReader = ConfigManager::registerReader();
+	if (prefetchReader < 0 ||
+	    xTaskCreatePinnedToCore(prefetchTaskMain, "prefetch", 4096, nullptr, 2, &prefetchTask, PREFETCH_CORE) != pdPASS)
 	{
-		WeatherFetcher::fetchWeather(m_weatherData, m_config.weatherApiKey);
-		m_lastWeatherUpdate = esp_timer_get_time() / 1000;
+		ESP_LOGW(TAG, "Content prefetch unavailable; preparing items on the display task");
+		prefetchTask = nullptr;
 	}
 }
 
-void DisplayController::updateDisplay()
+uint32_t DisplayController::updateDisplay()
+{
+	int64_t startUs = esp_timer_get_time();
+
+	// One atomic load per frame; the record is only copied on a change
+	if (m_configReader >= 0)
+	{
+		ConfigManager::quiescent(m_configReader);
+		const ConfigRecord* record = ConfigManager::read();
+		if (record->version != m_configVersion)
+		{
+			applyConfig(record->config, record->version);
+		}
+	}
+	else if (ConfigManager::getVersion() != m_configVersion)
+	{
+		DisplayConfig config;
+		uint32_t version = ConfigManager::getConfig(config);
+		applyConfig(config, version);
+	}
+
+	// Wraps after ~49.7 days of uptime: times derived from it are only
+	// ever compared through unsigned differences, never with < or >
+	uint32_t now = static_cast<uint32_t>(startUs / 1000);
+	uint32_t nextWakeMs = renderFrame(now);
+	accountBusyTime(startUs);
+	return nextWakeMs;
+}
+
+void DisplayController::waitForNextFrame(uint32_t delayMs)
+{
+	// Holds no config record while asleep, so saves never wait on us.
+	// Returns early when a new config is saved
+	ConfigManager::offline(m_configReader);
+	ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(delayMs));
+}
+
+void DisplayController::onConfigChanged(uint32_t version, void* ctx)
 {
-	// Reload config in case it changed via web UI
-	ConfigManager::loadConfig(m_config);
+	if (displayTask)
+	{
+		xTaskNotifyGive(displayTask);
+	}
+}
 
-	// Update display settings
-	m_display->setFlipped(m_config.displayFlipped);
-	m_display->setBrightness(m_config.brightness);
+void DisplayController::onMessageQueued(void* ctx)
+{
+	if (displayTask)
+	{
+		xTaskNotifyGive(displayTask);
+	}
+}
 
-	uint32_t now = esp_timer_get_time() / 1000;
+void DisplayController::prefetchTaskMain(void* arg)
+{
+	uint32_t handled = 0;
 
-	// Update weather if needed
-	if (m_config.showWeather && (now - m_lastWeatherUpdate > WEATHER_UPDATE_INTERVAL_MS))
+	while (true)
 	{
-		WeatherFetcher::fetchWeather(m_weatherData, m_config.weatherApiKey);
-		m_lastWeatherUpdate = now;
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+		// Only the latest request matters; older ones have been given up on
+		uint64_t request = prefetchRequest.load(std::memory_order_acquire);
+		uint32_t sequence = static_cast<uint32_t>(request >> 32);
+		if (sequence == handled)
+			continue;
+		handled = sequence;
+
+		ConfigManager::quiescent(prefetchReader);
+		const ConfigRecord* record = ConfigManager::read();
+
+		char text[CONTENT_TEXT_LEN];
+		PrefetchSlot& slot = prefetchSlots[sequence % 2];
+		DisplayManager::rasterize(formatContent(static_cast<ContentKind>((request >> 8) & 0xFF), request & 0xFF,
+		                                        record->config, text, sizeof(text)),
+		                          record->config.displayFlipped, slot.strip);
+		slot.configVersion = record->version;
+
+		ConfigManager::offline(prefetchReader);
+		slot.readySequence.store(sequence, std::memory_order_release);
 	}
+}
 
-	// Count enabled modes
-	int modeCount = 0;
-	if (m_config.showClock) modeCount++;
-	if (m_config.showWeather) modeCount++;
-	if (m_config.showStarWarsQuotes) modeCount++;
-	if (m_config.showLOTRQuotes) modeCount++;
-	if (strlen(m_config.customText) > 0) modeCount++;
+uint32_t DisplayController::getDutyCyclePermille()
+{
+	return dutyCyclePermille.load();
+}
 
-	if (modeCount == 0)
+void DisplayController::applyConfig(const DisplayConfig& config, uint32_t version)
+{
+	DisplayConfig previous = m_config;
+
+	m_config = config;
+	m_configVersion = version;
+
+	// Weather is fetched in the background; only nudge it when it matters
+	bool sourceChanged = strcmp(previous.weatherApiKey, m_config.weatherApiKey) != 0 ||
+	                     previous.weatherLocationCount != m_config.weatherLocationCount;
+	for (int i = 0; !sourceChanged && i < m_config.weatherLocationCount; i++)
 	{
-		// No modes enabled, show default message
-		m_display->scrollText("ESP-Clock - Configure via web UI", 50);
-		vTaskDelay(pdMS_TO_TICKS(5000));
-		return;
+		sourceChanged = strcmp(previous.weatherLocations[i], m_config.weatherLocations[i]) != 0;
+	}
+	if ((m_config.showWeather && (!previous.showWeather || sourceChanged)) ||
+	    (m_config.showForecast && (!previous.showForecast || sourceChanged)))
+	{
+		WeatherFetcher::requestUpdate();
 	}
 
-	// Switch mode if interval elapsed
-	if (now - m_lastModeSwitch > MODE_SWITCH_INTERVAL_MS)
+	if (m_config.displayFlipped != previous.displayFlipped)
+	{
+		m_display->setFlipped(m_config.displayFlipped);
+	}
+	if (m_config.brightness != previous.brightness)
 	{
-		m_currentMode = (m_currentMode + 1) % modeCount;
-		m_lastModeSwitch = now;
+		m_display->setBrightness(m_config.brightness);
 	}
 
-	// Display current mode
-	int modeIndex = 0;
+	// Brightness, flip and night hours alone leave the rotation running;
+	// blanking is re-evaluated on every frame anyway
+	bool contentChanged = sourceChanged ||
+	                      m_config.showClock != previous.showClock ||
+	                      m_config.showWeather != previous.showWeather ||
+	                      m_config.showForecast != previous.showForecast ||
+	                      m_config.showStarWarsQuotes != previous.showStarWarsQuotes ||
+	                      m_config.showLOTRQuotes != previous.showLOTRQuotes ||
+	                      strcmp(m_config.customText, previous.customText) != 0;
+	if (!contentChanged)
+		return;
 
-	if (m_config.showClock)
+	// Restart the rotation so a removed mode is never shown again; a
+	// message on screen finishes, but nothing interrupted is resumed
+	compilePlaylist();
+	m_idlePaused = false;
+	m_weatherRotation = 0;
+	m_forecastRotation = 0;
+	m_resumeAfterMessage = false;
+	if (m_message == nullptr)
 	{
-		if (modeIndex == m_currentMode)
+		m_display->stopScroll();
+	}
+}
+
+void DisplayController::compilePlaylist()
+{
+	static_assert(sizeof(CONTENT_DURATION_MS) / sizeof(CONTENT_DURATION_MS[0]) == CONTENT_KIND_COUNT,
+	              "One duration per content kind");
+
+	uint8_t weights[CONTENT_KIND_COUNT];
+	int credit[CONTENT_KIND_COUNT] = {};
+	int total = 0;
+
+	for (int kind = 0; kind < CONTENT_KIND_COUNT; kind++)
+	{
+		weights[kind] = contentWeight(static_cast<ContentKind>(kind), m_config);
+		total += weights[kind];
+	}
+
+	// Smooth weighted round-robin, so repeats of a heavy item are spread
+	// out instead of played back to back
+	m_playlistLength = 0;
+	for (int slot = 0; slot < total && slot < MAX_PLAYLIST_ITEMS; slot++)
+	{
+		int best = -1;
+		for (int kind = 0; kind < CONTENT_KIND_COUNT; kind++)
 		{
-			displayClock();
-			return;
+			if (weights[kind] == 0)
+				continue;
+			credit[kind] += weights[kind];
+			if (best < 0 || credit[kind] > credit[best])
+				best = kind;
 		}
-		modeIndex++;
+		credit[best] -= total;
+
+		PlaylistItem& item = m_playlist[m_playlistLength++];
+		item.kind = static_cast<ContentKind>(best);
+		item.durationMs = CONTENT_DURATION_MS[best];
+	}
+
+	m_playlistIndex = 0;
+	m_itemRunning = false;
+	m_itemQueued = false;
+	ESP_LOGI(TAG, "Playlist compiled: %d items", m_playlistLength);
+}
+
+void DisplayController::startItem(const PlaylistItem& item, uint32_t now)
+{
+	m_itemStartMs = now;
+	m_itemRunning = true;
+
+	// Normally the item was queued while the previous one was on screen;
+	// it isn't for the first item of a freshly compiled playlist
+	uint8_t location = m_itemQueued ? m_queuedLocation : claimLocation(item.kind);
+	const DisplayManager::TextStrip* strip = m_itemQueued ? takePrefetched() : nullptr;
+
+	if (item.kind == ContentKind::Clock)
+	{
+		m_lastClockMinute = -1;
 	}
+	else if (strip != nullptr)
+	{
+		m_display->startScroll(strip);
+	}
+	else
+	{
+		startScrollPass(item.kind, location);
+	}
+	queuePrefetch();
+}
+
+void DisplayController::startScrollPass(ContentKind kind, uint8_t location)
+{
+	char text[CONTENT_TEXT_LEN];
+	m_display->startScroll(formatContent(kind, location, m_config, text, sizeof(text)));
+}
+
+void DisplayController::nextItem()
+{
+	m_playlistIndex = (m_playlistIndex + 1) % m_playlistLength;
+	m_itemRunning = false;
+}
+
+uint8_t DisplayController::claimLocation(ContentKind kind)
+{
+	// Each pass of a weather mode shows the next location in the list
+	uint8_t* rotation = kind == ContentKind::Weather ? &m_weatherRotation :
+	                    kind == ContentKind::Forecast ? &m_forecastRotation : nullptr;
+	if (rotation == nullptr || m_config.weatherLocationCount == 0)
+		return 0;
+
+	uint8_t location = *rotation % m_config.weatherLocationCount;
+	*rotation = (location + 1) % m_config.weatherLocationCount;
+	return location;
+}
+
+void DisplayController::queuePrefetch()
+{
+	const PlaylistItem& next = m_playlist[(m_playlistIndex + 1) % m_playlistLength];
+
+	m_itemQueued = true;
+	m_queuedLocation = claimLocation(next.kind);
+	m_queuedSequence = 0;
+	if (next.kind == ContentKind::Clock || prefetchTask == nullptr)
+		return;
 
-	if (m_config.showWeather)
+	// Sequence 0 means "no request"
+	if (++m_lastSequence == 0)
+		++m_lastSequence;
+	m_queuedSequence = m_lastSequence;
+
+	uint64_t request = static_cast<uint64_t>(m_queuedSequence) << 32 |
+	                   static_cast<uint32_t>(next.kind) << 8 | m_queuedLocation;
+	prefetchRequest.store(request, std::memory_order_release);
+	xTaskNotifyGive(prefetchTask);
+}
+
+const DisplayManager::TextStrip* DisplayController::takePrefetched() const
+{
+	if (m_queuedSequence == 0)
+		return nullptr;
+
+	// Not ready yet, or prepared from a config we haven't applied: the
+	// caller formats the item itself instead of waiting
+	const PrefetchSlot& slot = prefetchSlots[m_queuedSequence % 2];
+	if (slot.readySequence.load(std::memory_order_acquire) != m_queuedSequence ||
+	    slot.configVersion != m_configVersion)
+		return nullptr;
+	return &slot.strip;
+}
+
+bool DisplayController::isNightTime(const struct tm& timeinfo) const
+{
+	uint8_t start = m_config.nightStartHour;
+	uint8_t end = m_config.nightEndHour;
+
+	if (start == end)
+		return false;
+
+	if (start < end)
+		return timeinfo.tm_hour >= start && timeinfo.tm_hour < end;
+
+	// Window wraps past midnight
+	return timeinfo.tm_hour >= start || timeinfo.tm_hour < end;
+}
+
+void DisplayController::accountBusyTime(int64_t startUs)
+{
+	int64_t endUs = esp_timer_get_time();
+	m_busyUs += endUs - startUs;
+
+	int64_t windowUs = endUs - m_dutyWindowStartUs;
+	if (windowUs >= DUTY_WINDOW_US)
+	{
+		uint32_t permille = static_cast<uint32_t>(m_busyUs * 1000 / windowUs);
+		dutyCyclePermille = permille;
+		ESP_LOGI(TAG, "Display task CPU duty cycle: %lu.%lu%%",
+		         static_cast<unsigned long>(permille / 10), static_cast<unsigned long>(permille % 10));
+		m_busyUs = 0;
+		m_dutyWindowStartUs = endUs;
+	}
+}
+
+uint32_t DisplayController::renderFrame(uint32_t now)
+{
+	// Scheduled night blanking: MAX7219 shutdown keeps the frame but turns the LEDs off
+	if (TimeSync::isTimeSynced())
 	{
-		if (modeIndex == m_currentMode)
+		struct tm timeinfo;
+		TimeSync::getCurrentTime(timeinfo);
+		if (isNightTime(timeinfo))
 		{
-			displayWeather();
-			return;
+			if (!m_blanked)
+			{
+				ESP_LOGI(TAG, "Night blanking on");
+				m_display->setShutdown(true);
+				m_blanked = true;
+			}
+
+			int hoursLeft = (m_config.nightEndHour - timeinfo.tm_hour + 24) % 24;
+			uint32_t msLeft = hoursLeft * 3600 * 1000 - (timeinfo.tm_min * 60 + timeinfo.tm_sec) * 1000;
+			return msLeft < NIGHT_MAX_SLEEP_MS ? msLeft + 5 : NIGHT_MAX_SLEEP_MS;
 		}
-		modeIndex++;
 	}
 
-	if (m_config.showStarWarsQuotes)
+	if (m_blanked)
 	{
-		if (modeIndex == m_currentMode)
+		ESP_LOGI(TAG, "Night blanking off");
+		m_display->setShutdown(false);
+		m_blanked = false;
+		m_lastClockMinute = -1;
+	}
+
+	// Queued messages: high priority interrupts at this frame, normal
+	// priority waits until the current scroll is over. The static clock
+	// can be interrupted by either.
+	if (m_message == nullptr)
+	{
+		bool atBoundary = m_playlistLength == 0 ? !m_display->isScrolling() : !m_itemRunning;
+		bool onClock = !atBoundary && m_playlistLength > 0 && m_playlist[m_playlistIndex].kind == ContentKind::Clock;
+		MessagePriority priority = MessagePriority::High;
+		const Message* message = MessageQueue::peek(priority);
+		if (message == nullptr && (atBoundary || onClock))
 		{
-			displayQuote(true);
-			return;
+			priority = MessagePriority::Normal;
+			message = MessageQueue::peek(priority);
+		}
+		if (message != nullptr)
+		{
+			beginMessage(message, priority, !atBoundary, now);
 		}
-		modeIndex++;
 	}
-
-	if (m_config.showLOTRQuotes)
+	else if (m_messagePriority == MessagePriority::Normal)
 	{
-		if (modeIndex == m_currentMode)
+		// High priority preempts a normal message too. The normal one stays
+		// at the head of its ring and starts over once the urgent one is done
+		const Message* urgent = MessageQueue::peek(MessagePriority::High);
+		if (urgent != nullptr)
 		{
-			displayQuote(false);
-			return;
+			beginMessage(urgent, MessagePriority::High, false, now);
+			m_preemptedNormal = true;
 		}
-		modeIndex++;
 	}
+	if (m_message != nullptr)
+		return renderMessage(now);
 
-	if (strlen(m_config.customText) > 0)
+	if (m_playlistLength == 0)
 	{
-		if (modeIndex == m_currentMode)
+		// No modes enabled, show default message
+		if (!m_display->isScrolling())
 		{
-			displayCustomText();
-			return;
+			// Millisecond time wraps after ~49 days; compare by difference
+			int32_t pauseLeft = static_cast<int32_t>(m_idleUntil - now);
+			if (m_idlePaused && pauseLeft > 0)
+				return pauseLeft;
+			m_idlePaused = false;
+			m_display->startScroll("ESP-Clock - Configure via web UI");
 		}
-		modeIndex++;
+		if (m_display->scrollStep())
+			return SCROLL_FRAME_MS;
+		m_idleUntil = now + IDLE_MESSAGE_PAUSE_MS;
+		m_idlePaused = true;
+		return IDLE_MESSAGE_PAUSE_MS;
 	}
-}
 
-void DisplayController::displayClock()
-{
-	if (!TimeSync::isTimeSynced())
+	// The playlist is compiled on config changes; a frame only looks at the current item
+	const PlaylistItem& item = m_playlist[m_playlistIndex];
+	if (!m_itemRunning)
 	{
-		m_display->displayText("--:--", 8);
-		m_display->update();
-		vTaskDelay(pdMS_TO_TICKS(1000));
-		return;
+		startItem(item, now);
 	}
+	uint32_t elapsed = now - m_itemStartMs;
 
-	struct tm timeinfo;
-	TimeSync::getCurrentTime(timeinfo);
-	m_display->displayClock(timeinfo.tm_hour, timeinfo.tm_min, false);
-	vTaskDelay(pdMS_TO_TICKS(1000));
+	if (item.kind == ContentKind::Clock)
+	{
+		if (m_playlistLength == 1)
+			return displayClock(UINT32_MAX);
+		if (elapsed < item.durationMs)
+			return displayClock(item.durationMs - elapsed);
+		nextItem();
+		return 1;
+	}
+
+	// Scrolling content advances one column per frame and moves on when
+	// its pass, or its time, is over
+	if (m_display->scrollStep())
+		return SCROLL_FRAME_MS;
+
+	if (elapsed < item.durationMs)
+		startScrollPass(item.kind, claimLocation(item.kind));
+	else
+		nextItem();
+	return SCROLL_FRAME_MS;
 }
 
-void DisplayController::displayWeather()
+void DisplayController::beginMessage(const Message* message, MessagePriority priority, bool interrupt, uint32_t now)
 {
-	char weatherStr[128];
-	WeatherFetcher::formatWeatherString(m_weatherData, weatherStr, sizeof(weatherStr));
-	m_display->scrollText(weatherStr, 50);
+	m_message = message;
+	m_messagePriority = priority;
+	m_messagePassesLeft = message->repeat;
+
+	if (interrupt)
+	{
+		m_display->suspendScroll(m_suspendedScroll);
+		m_suspendedAtMs = now;
+		m_resumeAfterMessage = true;
+	}
+	m_display->startScroll(message->text);
 }
 
-void DisplayController::displayQuote(bool starWars)
+uint32_t DisplayController::renderMessage(uint32_t now)
 {
-	const char* quote = starWars ? Quotes::getStarWarsQuote() : Quotes::getLOTRQuote();
-	m_display->scrollText(quote, 50);
+	if (m_display->scrollStep())
+		return SCROLL_FRAME_MS;
+
+	if (--m_messagePassesLeft > 0)
+	{
+		m_display->startScroll(m_message->text);
+		return SCROLL_FRAME_MS;
+	}
+
+	MessageQueue::pop(m_messagePriority);
+	m_message = nullptr;
+	m_lastClockMinute = -1;
+
+	// A preempted normal message comes back before anything it interrupted
+	if (m_preemptedNormal)
+	{
+		m_preemptedNormal = false;
+		const Message* next = MessageQueue::peek(MessagePriority::Normal);
+		if (next != nullptr)
+		{
+			beginMessage(next, MessagePriority::Normal, false, now);
+			return SCROLL_FRAME_MS;
+		}
+	}
+
+	if (m_resumeAfterMessage)
+	{
+		// Continue mid-scroll; the interruption doesn't count against the item's time
+		m_display->resumeScroll(m_suspendedScroll);
+		m_itemStartMs += now - m_suspendedAtMs;
+		m_resumeAfterMessage = false;
+	}
+	return SCROLL_FRAME_MS;
 }
 
-void DisplayController::displayCustomText()
+uint32_t DisplayController::displayClock(uint32_t maxWaitMs)
 {
-	m_display->scrollText(m_config.customText, 50);
+	if (!TimeSync::isTimeSynced())
+	{
+		if (m_lastClockMinute != -2)
+		{
+			m_display->displayText("--:--", 8);
+			m_lastClockMinute = -2;
+		}
+		return maxWaitMs < CLOCK_UNSYNCED_POLL_MS ? maxWaitMs : CLOCK_UNSYNCED_POLL_MS;
+	}
+
+	// Static content: only redraw when the minute changes
+	struct tm timeinfo;
+	TimeSync::getCurrentTime(timeinfo);
+	int minuteOfDay = timeinfo.tm_hour * 60 + timeinfo.tm_min;
+	if (minuteOfDay != m_lastClockMinute)
+	{
+		m_display->displayClock(timeinfo.tm_hour, timeinfo.tm_min, false);
+		m_lastClockMinute = minuteOfDay;
+	}
+
+	uint32_t untilMinute = msUntilNextMinute();
+	return maxWaitMs < untilMinute ? maxWaitMs : untilMinute;
 }
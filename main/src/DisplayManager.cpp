@@ -1,7 +1,19 @@
 #include "DisplayManager.hpp"
 #include "Font5x7.hpp"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include <cstring>
 
+namespace
+{
+	const int DISPLAY_DEVICES = 5;
+	const int DISPLAY_WIDTH = DISPLAY_DEVICES * 8;
+
+	// There is one display, and static storage keeps the strips off the
+	// creating task's stack. Two, so a suspended scroll survives the next one.
+	DisplayManager::TextStrip textStrips[2];
+}
+
 DisplayManager::DisplayManager(MAX7219* display)
 	: m_display(display)
 	, m_scrollOffset(0)
@@ -23,7 +35,7 @@ void DisplayManager::drawChar(char c, int xOffset)
 	for (int col = 0; col < 5; col++)
 	{
 		int globalX = xOffset + col;
-		if (globalX < 0 || globalX >= 40)  // 5 devices * 8 pixels
+		if (globalX < 0 || globalX >= DISPLAY_WIDTH)
 			continue;
 
 		int device = globalX / 8;
@@ -84,48 +96,137 @@ void DisplayManager::displayText(const char* text, int startX)
 
 void DisplayManager::scrollText(const char* text, int scrollSpeedMs)
 {
-	if (!text || strlen(text) == 0)
+	startScroll(text);
+	while (scrollStep())
+	{
+		vTaskDelay(pdMS_TO_TICKS(scrollSpeedMs));
+	}
+}
+
+void DisplayManager::startScroll(const char* text)
+{
+	if (!text || text[0] == '\0')
+	{
+		m_scrolling = false;
 		return;
+	}
 
-	size_t textLen = strlen(text);
-	int textWidth = textLen * 6;  // 6 pixels per character (5 + 1 spacing)
-	int displayWidth = 40;  // 5 devices * 8 pixels
+	rasterize(text, m_flipped, textStrips[m_textStrip]);
+	startScroll(&textStrips[m_textStrip]);
+}
+
+void DisplayManager::startScroll(const TextStrip* strip)
+{
+	if (!strip || strip->width == 0)
+	{
+		m_scrolling = false;
+		return;
+	}
+
+	m_strip = strip;
+	m_scrollOffset = -static_cast<int>(strip->width);
+	m_scrolling = true;
+}
+
+void DisplayManager::stopScroll()
+{
+	m_scrolling = false;
+}
+
+bool DisplayManager::scrollStep()
+{
+	if (!m_scrolling)
+		return false;
+
+	if (m_scrollOffset >= DISPLAY_WIDTH)
+	{
+		m_scrolling = false;
+		return false;
+	}
 
 	// Scroll from right to left (start offscreen right, move left)
-	for (int offset = -textWidth; offset < displayWidth; offset++)
+	drawStripAt(*m_strip, m_scrollOffset);
+	m_scrollOffset++;
+	return true;
+}
+
+bool DisplayManager::isScrolling() const
+{
+	return m_scrolling;
+}
+
+void DisplayManager::suspendScroll(ScrollState& state)
+{
+	state.strip = m_strip;
+	state.offset = m_scrollOffset;
+	state.scrolling = m_scrolling;
+	m_scrolling = false;
+
+	// Leave our own strip to the suspended scroll
+	if (m_strip == &textStrips[m_textStrip])
 	{
-		clear();
+		m_textStrip ^= 1;
+	}
+}
+
+void DisplayManager::resumeScroll(ScrollState& state)
+{
+	m_strip = state.strip;
+	m_scrollOffset = state.offset;
+	m_scrolling = state.scrolling;
+	state.scrolling = false;
+}
+
+void DisplayManager::rasterize(const char* text, bool flipped, TextStrip& strip)
+{
+	size_t textLen = strnlen(text, TextStrip::MAX_CHARS);
+	uint8_t* column = strip.columns;
 
-		if (m_flipped)
+	for (size_t n = 0; n < textLen; n++)
+	{
+		// Characters run in reverse order, each mirrored, when flipped
+		const uint8_t* bitmap = Font5x7::getChar(flipped ? text[textLen - 1 - n] : text[n]);
+		for (int col = 0; col < 5; col++)
 		{
-			// Draw characters in reverse order when flipped
-			int x = offset;
-			for (int i = textLen - 1; i >= 0; i--)
-			{
-				if (x + 5 >= 0 && x < displayWidth)
-				{
-					drawChar(text[i], x);
-				}
-				x += 6;
-			}
+			*column++ = bitmap ? bitmap[flipped ? (4 - col) : col] : 0;
 		}
-		else
+		*column++ = 0;
+	}
+
+	strip.width = static_cast<uint16_t>(column - strip.columns);
+	strip.flipped = flipped;
+}
+
+void DisplayManager::drawStripAt(const TextStrip& strip, int offset)
+{
+	for (int device = 0; device < DISPLAY_DEVICES; device++)
+	{
+		// Every row is rewritten, so no clear() and its extra transfer is needed
+		uint8_t rows[8] = {};
+		for (int deviceCol = 0; deviceCol < 8; deviceCol++)
 		{
-			// Draw characters in normal order
-			int x = offset;
-			for (size_t i = 0; i < textLen; i++)
+			int x = device * 8 + deviceCol - offset;
+			if (x < 0 || x >= strip.width)
+				continue;
+
+			uint8_t colData = strip.columns[x];
+			for (int row = 0; row < 8; row++)
 			{
-				if (x + 5 >= 0 && x < displayWidth)
+				if (colData & (1 << row))
 				{
-					drawChar(text[i], x);
+					// Flip Y (vertical) for upside-down display
+					rows[strip.flipped ? 7 - row : row] |= 1 << (7 - deviceCol);
 				}
-				x += 6;
 			}
 		}
 
-		m_display->displayBuffer();
-		vTaskDelay(pdMS_TO_TICKS(scrollSpeedMs));
+		for (int row = 0; row < 8; row++)
+		{
+			m_display->setRow(device, row, rows[row]);
+		}
 	}
+
+	m_display->displayBuffer();
 }
 
 void DisplayManager::displayClock(int hour, int minute, bool showSeconds)
@@ -155,5 +256,16 @@ void DisplayManager::setBrightness(uint8_t intensity)
 	// MAX7219 supports brightness values 0-15
 	if (intensity > 15)
 		intensity = 15;
+
+	// Skip the SPI write when nothing changed
+	if (intensity == m_brightness)
+		return;
+
+	m_brightness = intensity;
 	m_display->setBrightness(intensity);
 }
+
+void DisplayManager::setShutdown(bool shutdown)
+{
+	m_display->setShutdown(shutdown);
+}
@@ -0,0 +1,426 @@
+#include "JsonScanner.hpp"
+#include <cstring>
+
+namespace
+{
+	bool isWhitespace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	}
+
+	bool isLiteralChar(char c)
+	{
+		return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+		       c == 'E' || c == '+' || c == '-' || c == '.';
+	}
+
+	int hexValue(char c)
+	{
+		if (c >= '0' && c <= '9') return c - '0';
+		if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+		if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+		return -1;
+	}
+}
+
+JsonScanner::JsonScanner(ValueCallback onValue, void* ctx, ContainerEndCallback onContainerEnd)
+	: m_onValue(onValue)
+	, m_onContainerEnd(onContainerEnd)
+	, m_ctx(ctx)
+{
+	reset();
+}
+
+void JsonScanner::reset()
+{
+	m_state = State::Value;
+	m_depth = 0;
+	m_valueLen = 0;
+	m_value[0] = '\0';
+	m_truncated = false;
+	m_keyTruncated = false;
+	m_escape = false;
+	m_unicodeDigits = 0;
+	m_codePoint = 0;
+	m_highSurrogate = 0;
+}
+
+bool JsonScanner::feed(const char* data, size_t len)
+{
+	for (size_t i = 0; i < len; i++)
+	{
+		if (!step(data[i]))
+		{
+			m_state = State::Error;
+			return false;
+		}
+	}
+	return true;
+}
+
+bool JsonScanner::matches(const char* pattern) const
+{
+	const char* p = pattern;
+
+	for (size_t i = 0; i < m_depth; i++)
+	{
+		const Level& level = m_levels[i];
+
+		if (level.isArray)
+		{
+			if (*p++ != '[')
+				return false;
+
+			if (p[0] == '*' && p[1] == ']')
+			{
+				p += 2;
+				continue;
+			}
+
+			int index = 0;
+			const char* digits = p;
+			while (*p >= '0' && *p <= '9')
+			{
+				index = index * 10 + (*p++ - '0');
+			}
+			if (p == digits || *p++ != ']' || index != level.index)
+				return false;
+		}
+		else
+		{
+			if (i > 0 && *p++ != '.')
+				return false;
+
+			size_t keyLen = 0;
+			while (p[keyLen] != '\0' && p[keyLen] != '.' && p[keyLen] != '[')
+			{
+				keyLen++;
+			}
+			if (keyLen == 0 || strlen(level.key) != keyLen || strncmp(p, level.key, keyLen) != 0)
+				return false;
+			p += keyLen;
+		}
+	}
+
+	return *p == '\0';
+}
+
+int JsonScanner::indexAt(size_t level) const
+{
+	if (level >= m_depth || !m_levels[level].isArray)
+		return -1;
+	return m_levels[level].index;
+}
+
+bool JsonScanner::step(char c)
+{
+	switch (m_state)
+	{
+	case State::Value:
+		if (isWhitespace(c))
+			return true;
+		return beginValue(c);
+
+	case State::ArrayStart:
+		if (isWhitespace(c))
+			return true;
+		if (c == ']')
+			return pop(true);
+		return beginValue(c);
+
+	case State::ObjectStart:
+	case State::Key:
+		if (isWhitespace(c))
+			return true;
+		if (c == '}' && m_state == State::ObjectStart)
+			return pop(false);
+		if (c != '"')
+			return false;
+		m_valueLen = 0;
+		m_truncated = false;
+		m_state = State::KeyString;
+		return true;
+
+	case State::Colon:
+		if (isWhitespace(c))
+			return true;
+		if (c != ':')
+			return false;
+		m_state = State::Value;
+		return true;
+
+	case State::KeyString:
+	case State::ValueString:
+		if (m_unicodeDigits > 0)
+		{
+			int digit = hexValue(c);
+			if (digit < 0)
+				return false;
+			m_codePoint = (m_codePoint << 4) | digit;
+			if (--m_unicodeDigits == 0)
+			{
+				if (m_codePoint >= 0xD800 && m_codePoint <= 0xDBFF)
+				{
+					m_highSurrogate = m_codePoint;
+				}
+				else if (m_codePoint >= 0xDC00 && m_codePoint <= 0xDFFF && m_highSurrogate != 0)
+				{
+					appendCodePoint(0x10000 + ((m_highSurrogate - 0xD800) << 10) + (m_codePoint - 0xDC00));
+					m_highSurrogate = 0;
+				}
+				else
+				{
+					appendCodePoint(m_codePoint);
+					m_highSurrogate = 0;
+				}
+			}
+			return true;
+		}
+
+		if (m_escape)
+		{
+			m_escape = false;
+			switch (c)
+			{
+			case '"':
+			case '\\':
+			case '/': appendChar(c); break;
+			case 'b': appendChar('\b'); break;
+			case 'f': appendChar('\f'); break;
+			case 'n': appendChar('\n'); break;
+			case 'r': appendChar('\r'); break;
+			case 't': appendChar('\t'); break;
+			case 'u':
+				m_unicodeDigits = 4;
+				m_codePoint = 0;
+				break;
+			default:
+				return false;
+			}
+			return true;
+		}
+
+		if (c == '\\')
+		{
+			m_escape = true;
+			return true;
+		}
+
+		if (c == '"')
+		{
+			m_value[m_valueLen] = '\0';
+			if (m_state == State::KeyString)
+			{
+				// A truncated key must not match a pattern by its prefix
+				Level& level = m_levels[m_depth - 1];
+				if (m_truncated)
+				{
+					level.key[0] = '\0';
+					m_keyTruncated = true;
+				}
+				else
+				{
+					memcpy(level.key, m_value, m_valueLen + 1);
+				}
+				m_state = State::Colon;
+			}
+			else
+			{
+				emit(JsonType::String);
+			}
+			return true;
+		}
+
+		if (static_cast<unsigned char>(c) < 0x20)
+			return false;
+
+		appendChar(c);
+		return true;
+
+	case State::Literal:
+		if (isLiteralChar(c))
+		{
+			appendChar(c);
+			return true;
+		}
+		// The terminating character belongs to the enclosing container
+		return endLiteral() && step(c);
+
+	case State::AfterValue:
+		if (isWhitespace(c))
+			return true;
+		if (c == ',')
+		{
+			m_state = m_levels[m_depth - 1].isArray ? State::Value : State::Key;
+			return true;
+		}
+		if (c == '}')
+			return pop(false);
+		if (c == ']')
+			return pop(true);
+		return false;
+
+	case State::Done:
+		return isWhitespace(c);
+
+	case State::Error:
+		return false;
+	}
+
+	return false;
+}
+
+bool JsonScanner::beginValue(char c)
+{
+	if (m_depth > 0 && m_levels[m_depth - 1].isArray)
+	{
+		m_levels[m_depth - 1].index++;
+	}
+
+	m_valueLen = 0;
+	m_truncated = false;
+
+	switch (c)
+	{
+	case '{':
+		if (!push(false))
+			return false;
+		m_state = State::ObjectStart;
+		return true;
+
+	case '[':
+		if (!push(true))
+			return false;
+		m_state = State::ArrayStart;
+		return true;
+
+	case '"':
+		m_state = State::ValueString;
+		return true;
+
+	default:
+		if (c != '-' && !(c >= '0' && c <= '9') && c != 't' && c != 'f' && c != 'n')
+			return false;
+		appendChar(c);
+		m_state = State::Literal;
+		return true;
+	}
+}
+
+bool JsonScanner::push(bool isArray)
+{
+	if (m_depth >= MAX_DEPTH)
+		return false;
+
+	Level& level = m_levels[m_depth++];
+	level.isArray = isArray;
+	level.index = -1;
+	level.key[0] = '\0';
+	return true;
+}
+
+bool JsonScanner::pop(bool isArray)
+{
+	if (m_depth == 0 || m_levels[m_depth - 1].isArray != isArray)
+		return false;
+
+	m_depth--;
+	if (m_onContainerEnd)
+	{
+		m_onContainerEnd(*this, m_ctx);
+	}
+	m_state = (m_depth == 0) ? State::Done : State::AfterValue;
+	return true;
+}
+
+// Keys are collected in m_value too, but must fit a path level
+size_t JsonScanner::capacity() const
+{
+	return m_state == State::KeyString ? MAX_KEY_LEN : MAX_VALUE_LEN;
+}
+
+void JsonScanner::appendChar(char c)
+{
+	if (m_valueLen < capacity())
+	{
+		m_value[m_valueLen++] = c;
+	}
+	else
+	{
+		m_truncated = true;
+	}
+}
+
+void JsonScanner::appendCodePoint(uint32_t cp)
+{
+	char bytes[4];
+	size_t count;
+
+	if (cp < 0x80)
+	{
+		bytes[0] = static_cast<char>(cp);
+		count = 1;
+	}
+	else if (cp < 0x800)
+	{
+		bytes[0] = static_cast<char>(0xC0 | (cp >> 6));
+		bytes[1] = static_cast<char>(0x80 | (cp & 0x3F));
+		count = 2;
+	}
+	else if (cp < 0x10000)
+	{
+		bytes[0] = static_cast<char>(0xE0 | (cp >> 12));
+		bytes[1] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+		bytes[2] = static_cast<char>(0x80 | (cp & 0x3F));
+		count = 3;
+	}
+	else
+	{
+		bytes[0] = static_cast<char>(0xF0 | (cp >> 18));
+		bytes[1] = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+		bytes[2] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+		bytes[3] = static_cast<char>(0x80 | (cp & 0x3F));
+		count = 4;
+	}
+
+	// Never leave half a multi-byte sequence at the end of the value
+	if (m_valueLen + count > capacity())
+	{
+		m_truncated = true;
+		return;
+	}
+	memcpy(m_value + m_valueLen, bytes, count);
+	m_valueLen += count;
+}
+
+void JsonScanner::emit(JsonType type)
+{
+	m_value[m_valueLen] = '\0';
+	if (m_onValue)
+	{
+		m_onValue(*this, type, m_value, m_ctx);
+	}
+	m_state = (m_depth == 0) ? State::Done : State::AfterValue;
+}
+
+bool JsonScanner::endLiteral()
+{
+	m_value[m_valueLen] = '\0';
+
+	if (strcmp(m_value, "true") == 0 || strcmp(m_value, "false") == 0)
+	{
+		emit(JsonType::Bool);
+		return true;
+	}
+	if (strcmp(m_value, "null") == 0)
+	{
+		emit(JsonType::Null);
+		return true;
+	}
+	if (m_value[0] == '-' || (m_value[0] >= '0' && m_value[0] <= '9'))
+	{
+		emit(JsonType::Number);
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,174 @@
+#include "JsonWriter.hpp"
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+JsonWriter::JsonWriter(FlushCallback flush, void* ctx)
+	: m_flush(flush)
+	, m_ctx(ctx)
+{
+}
+
+void JsonWriter::beginObject(const char* key)
+{
+	beginContainer(key, '{');
+}
+
+void JsonWriter::endObject()
+{
+	endContainer('}');
+}
+
+void JsonWriter::beginArray(const char* key)
+{
+	beginContainer(key, '[');
+}
+
+void JsonWriter::endArray()
+{
+	endContainer(']');
+}
+
+void JsonWriter::addBool(const char* key, bool value)
+{
+	beginValue(key);
+	write(value ? "true" : "false", value ? 4 : 5);
+}
+
+void JsonWriter::addInt(const char* key, int64_t value)
+{
+	char digits[24];
+	int len = snprintf(digits, sizeof(digits), "%" PRId64, value);
+
+	beginValue(key);
+	write(digits, len);
+}
+
+void JsonWriter::addString(const char* key, const char* value)
+{
+	beginValue(key);
+	if (value == nullptr)
+	{
+		write("null", 4);
+		return;
+	}
+	put('"');
+	writeEscaped(value);
+	put('"');
+}
+
+bool JsonWriter::finish()
+{
+	if (m_depth != 0)
+	{
+		m_failed = true;
+	}
+	return flush() && !m_failed;
+}
+
+void JsonWriter::beginValue(const char* key)
+{
+	uint32_t bit = 1u << m_depth;
+	if (m_hasValue & bit)
+	{
+		put(',');
+	}
+	m_hasValue |= bit;
+
+	if (key != nullptr)
+	{
+		put('"');
+		writeEscaped(key);
+		put('"');
+		put(':');
+	}
+}
+
+void JsonWriter::beginContainer(const char* key, char open)
+{
+	if (m_depth >= MAX_DEPTH)
+	{
+		m_failed = true;
+		return;
+	}
+	beginValue(key);
+	put(open);
+	m_hasValue &= ~(1u << ++m_depth);
+}
+
+void JsonWriter::endContainer(char close)
+{
+	if (m_depth == 0)
+	{
+		m_failed = true;
+		return;
+	}
+	m_depth--;
+	put(close);
+}
+
+void JsonWriter::writeEscaped(const char* text)
+{
+	static const char hex[] = "0123456789abcdef";
+
+	for (; *text; text++)
+	{
+		unsigned char c = static_cast<unsigned char>(*text);
+		switch (c)
+		{
+		case '"':  write("\\\"", 2); break;
+		case '\\': write("\\\\", 2); break;
+		case '\b': write("\\b", 2); break;
+		case '\f': write("\\f", 2); break;
+		case '\n': write("\\n", 2); break;
+		case '\r': write("\\r", 2); break;
+		case '\t': write("\\t", 2); break;
+		case '<':  write("\\u003c", 6); break;
+		default:
+			if (c < 0x20)
+			{
+				char escape[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0x0F]};
+				write(escape, sizeof(escape));
+			}
+			else
+			{
+				put(static_cast<char>(c));
+			}
+			break;
+		}
+	}
+}
+
+void JsonWriter::write(const char* data, size_t len)
+{
+	while (len > 0 && !m_failed)
+	{
+		if (m_used == BUFFER_SIZE && !flush())
+			return;
+
+		size_t space = BUFFER_SIZE - m_used;
+		size_t count = len < space ? len : space;
+		memcpy(m_buffer + m_used, data, count);
+		m_used += count;
+		data += count;
+		len -= count;
+	}
+}
+
+void JsonWriter::put(char c)
+{
+	write(&c, 1);
+}
+
+bool JsonWriter::flush()
+{
+	if (m_used > 0 && !m_failed)
+	{
+		if (!m_flush(m_buffer, m_used, m_ctx))
+		{
+			m_failed = true;
+		}
+		m_used = 0;
+	}
+	return !m_failed;
+}
@@ -122,6 +122,13 @@ void MAX7219::setBrightness(uint8_t intensity)
 	writeAll(REG_INTENSITY, intensity);
 }
 
+void MAX7219::setShutdown(bool shutdown)
+{
+	// Shutdown blanks the LEDs but keeps the digit registers, so the
+	// current frame reappears unchanged on wake-up
+	writeAll(REG_SHUTDOWN, shutdown ? 0x00 : 0x01);
+}
+
 void MAX7219::setPixel(int device, int row, int col, bool on)
 {
 	if (device < 0 || device >= m_numDevices)
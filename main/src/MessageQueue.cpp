@@ -0,0 +1,108 @@
+#include "MessageQueue.hpp"
+#include "esp_timer.h"
+#include <atomic>
+#include <cstring>
+
+namespace
+{
+	/**
+	 * Head is advanced only by the consumer and tail only by the producer.
+	 * Both count up forever; the slot is the count modulo CAPACITY. The
+	 * release store of tail publishes the slot's contents to the consumer,
+	 * and the release store of head hands the slot back to the producer.
+	 */
+	struct Ring
+	{
+		Message slots[MessageQueue::CAPACITY];
+		std::atomic<uint32_t> head{0};
+		std::atomic<uint32_t> tail{0};
+	};
+
+	Ring rings[static_cast<int>(MessagePriority::Count)];
+	// Set once during startup, before any push()
+	MessageQueue::ArrivalCallback arrivalCallback = nullptr;
+	void* arrivalCtx = nullptr;
+
+	std::atomic<uint32_t> queuedCount{0};
+	std::atomic<uint32_t> rejectedCount{0};
+	std::atomic<uint32_t> expiredCount{0};
+	std::atomic<uint32_t> shownCount{0};
+
+	uint32_t nowMs()
+	{
+		return static_cast<uint32_t>(esp_timer_get_time() / 1000);
+	}
+
+	// Wraps after ~49 days; compare by difference
+	bool hasExpired(const Message& message, uint32_t now)
+	{
+		return static_cast<int32_t>(now - message.expiresAtMs) >= 0;
+	}
+}
+
+void MessageQueue::setArrivalListener(ArrivalCallback callback, void* ctx)
+{
+	arrivalCtx = ctx;
+	arrivalCallback = callback;
+}
+
+bool MessageQueue::push(const char* text, MessagePriority priority, uint32_t ttlSeconds, uint8_t repeat)
+{
+	Ring& ring = rings[static_cast<int>(priority)];
+	uint32_t tail = ring.tail.load(std::memory_order_relaxed);
+	if (tail - ring.head.load(std::memory_order_acquire) >= CAPACITY)
+	{
+		rejectedCount++;
+		return false;
+	}
+
+	Message& message = ring.slots[tail % CAPACITY];
+	strncpy(message.text, text, sizeof(message.text) - 1);
+	message.text[sizeof(message.text) - 1] = '\0';
+	message.repeat = repeat > 0 ? repeat : 1;
+	message.expiresAtMs = nowMs() + ttlSeconds * 1000;
+	ring.tail.store(tail + 1, std::memory_order_release);
+	queuedCount++;
+
+	if (arrivalCallback != nullptr)
+	{
+		arrivalCallback(arrivalCtx);
+	}
+	return true;
+}
+
+const Message* MessageQueue::peek(MessagePriority priority)
+{
+	Ring& ring = rings[static_cast<int>(priority)];
+	uint32_t head = ring.head.load(std::memory_order_relaxed);
+
+	while (head != ring.tail.load(std::memory_order_acquire))
+	{
+		const Message& message = ring.slots[head % CAPACITY];
+		if (!hasExpired(message, nowMs()))
+			return &message;
+
+		ring.head.store(++head, std::memory_order_release);
+		expiredCount++;
+	}
+	return nullptr;
+}
+
+void MessageQueue::pop(MessagePriority priority)
+{
+	Ring& ring = rings[static_cast<int>(priority)];
+	uint32_t head = ring.head.load(std::memory_order_relaxed);
+	if (head != ring.tail.load(std::memory_order_acquire))
+	{
+		ring.head.store(head + 1, std::memory_order_release);
+		shownCount++;
+	}
+}
+
+void MessageQueue::getStats(MessageQueueStats& stats)
+{
+	stats.queued = queuedCount.load();
+	stats.rejected = rejectedCount.load();
+	stats.expired = expiredCount.load();
+	stats.shown = shownCount.load();
+}
@@ -0,0 +1,263 @@
+#include "OpenWeatherMapProvider.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+	WeatherCondition conditionFromId(int id)
+	{
+		switch (id / 100)
+		{
+		case 2: return WeatherCondition::Storm;
+		case 3: return WeatherCondition::Drizzle;
+		case 5: return WeatherCondition::Rain;
+		case 6: return WeatherCondition::Snow;
+		case 7: return WeatherCondition::Fog;
+		default: return id == 800 ? WeatherCondition::Clear : WeatherCondition::Clouds;
+		}
+	}
+
+	// Percent-encode a location for the query string
+	bool appendEncoded(char* dest, size_t size, size_t& len, const char* text)
+	{
+		const char* hex = "0123456789ABCDEF";
+
+		for (; *text; text++)
+		{
+			unsigned char c = static_cast<unsigned char>(*text);
+			bool plain = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+			             c == '-' || c == '_' || c == '.' || c == '~' || c == ',';
+
+			if (len + (plain ? 1 : 3) >= size)
+				return false;
+
+			if (plain)
+			{
+				dest[len++] = c;
+			}
+			else
+			{
+				dest[len++] = '%';
+				dest[len++] = hex[c >> 4];
+				dest[len++] = hex[c & 0x0F];
+			}
+		}
+		dest[len] = '\0';
+		return true;
+	}
+}
+
+bool OpenWeatherMapProvider::buildPath(const char* endpoint, const char* location, const char* apiKey,
+                                       char* path, size_t size) const
+{
+	int len = snprintf(path, size, "/data/2.5/%s?q=", endpoint);
+	if (len < 0 || static_cast<size_t>(len) >= size)
+		return false;
+
+	size_t used = len;
+	if (!appendEncoded(path, size, used, location))
+		return false;
+
+	len = snprintf(path + used, size - used, "&appid=%s&units=metric", apiKey);
+	return len >= 0 && static_cast<size_t>(len) < size - used;
+}
+
+bool OpenWeatherMapProvider::currentPath(const char* location, const char* apiKey, char* path, size_t size) const
+{
+	return buildPath("weather", location, apiKey, path, size);
+}
+
+bool OpenWeatherMapProvider::forecastPath(const char* location, const char* apiKey, char* path, size_t size) const
+{
+	return buildPath("forecast", location, apiKey, path, size);
+}
+
+ResponseParser& OpenWeatherMapProvider::beginCurrent(WeatherData& data)
+{
+	m_current.begin(data);
+	return m_current;
+}
+
+ResponseParser& OpenWeatherMapProvider::beginForecast(ForecastData& forecast)
+{
+	m_forecast.begin(forecast);
+	return m_forecast;
+}
+
+OpenWeatherMapProvider::CurrentParser::CurrentParser()
+	: m_scanner(onValue, this)
+{
+}
+
+void OpenWeatherMapProvider::CurrentParser::begin(WeatherData& data)
+{
+	data = {};
+	m_data = &data;
+	m_haveTemperature = false;
+	m_scanner.reset();
+}
+
+bool OpenWeatherMapProvider::CurrentParser::feed(const char* data, size_t len)
+{
+	return m_scanner.feed(data, len);
+}
+
+bool OpenWeatherMapProvider::CurrentParser::finish()
+{
+	m_data->valid = m_scanner.isComplete() && m_haveTemperature;
+	return m_data->valid;
+}
+
+void OpenWeatherMapProvider::CurrentParser::onValue(const JsonScanner& scanner, JsonType type, const char* value, void* ctx)
+{
+	CurrentParser* parser = static_cast<CurrentParser*>(ctx);
+	WeatherData& data = *parser->m_data;
+
+	if (type == JsonType::Number)
+	{
+		if (scanner.matches("dt"))
+		{
+			data.observedAt = strtoll(value, nullptr, 10);
+		}
+		else if (scanner.matches("main.temp"))
+		{
+			data.temperature = strtof(value, nullptr);
+			parser->m_haveTemperature = true;
+		}
+		else if (scanner.matches("main.humidity"))
+		{
+			data.humidity = atoi(value);
+		}
+	}
+	else if (type == JsonType::String)
+	{
+		if (scanner.matches("weather[0].description"))
+		{
+			strncpy(data.description, value, sizeof(data.description) - 1);
+		}
+		else if (scanner.matches("weather[0].icon"))
+		{
+			strncpy(data.icon, value, sizeof(data.icon) - 1);
+		}
+	}
+}
+
+OpenWeatherMapProvider::ForecastParser::ForecastParser()
+	: m_scanner(onValue, this, onContainerEnd)
+{
+}
+
+void OpenWeatherMapProvider::ForecastParser::begin(ForecastData& forecast)
+{
+	forecast = {};
+	m_forecast = &forecast;
+	m_scanner.reset();
+	resetSlot();
+}
+
+bool OpenWeatherMapProvider::ForecastParser::feed(const char* data, size_t len)
+{
+	return m_scanner.feed(data, len);
+}
+
+bool OpenWeatherMapProvider::ForecastParser::finish()
+{
+	m_forecast->valid = m_scanner.isComplete() && m_forecast->dayCount > 0;
+	return m_forecast->valid;
+}
+
+void OpenWeatherMapProvider::ForecastParser::resetSlot()
+{
+	m_slotAt = 0;
+	m_slotMin = 1000.0f;
+	m_slotMax = -1000.0f;
+	m_slotPop = 0.0f;
+	m_slotConditionId = 0;
+}
+
+// Fold a completed slot into its local calendar day
+void OpenWeatherMapProvider::ForecastParser::foldSlot()
+{
+	ForecastData& forecast = *m_forecast;
+	if (m_slotAt == 0 || m_slotMin > m_slotMax)
+		return;
+
+	int32_t dayKey = ForecastData::dayKeyFor(m_slotAt);
+	ForecastDay* day = forecast.dayCount > 0 ? &forecast.days[forecast.dayCount - 1] : nullptr;
+
+	if (day == nullptr || day->dayKey != dayKey)
+	{
+		// Slots are in time order; anything past the last day is dropped
+		if (forecast.dayCount >= ForecastData::MAX_DAYS || (day && dayKey < day->dayKey))
+			return;
+
+		day = &forecast.days[forecast.dayCount++];
+		*day = {};
+		day->firstSlotAt = m_slotAt;
+		day->dayKey = dayKey;
+		day->minTemp = m_slotMin;
+		day->maxTemp = m_slotMax;
+	}
+
+	if (m_slotMin < day->minTemp) day->minTemp = m_slotMin;
+	if (m_slotMax > day->maxTemp) day->maxTemp = m_slotMax;
+
+	int pop = static_cast<int>(m_slotPop * 100.0f + 0.5f);
+	if (pop > day->precipChance) day->precipChance = pop > 100 ? 100 : pop;
+
+	if (m_slotConditionId != 0)
+	{
+		int group = static_cast<int>(conditionFromId(m_slotConditionId));
+		day->conditionSlots[group]++;
+
+		// Strictly greater, so ties keep the more severe (lower) group.
+		// Unknown is never counted, so any counted group displaces it
+		int dominant = static_cast<int>(WeatherCondition::Unknown);
+		for (int i = dominant + 1; i < static_cast<int>(WeatherCondition::Count); i++)
+		{
+			if (day->conditionSlots[i] > day->conditionSlots[dominant])
+				dominant = i;
+		}
+		day->condition = static_cast<WeatherCondition>(dominant);
+	}
+}
+
+void OpenWeatherMapProvider::ForecastParser::onValue(const JsonScanner& scanner, JsonType type, const char* value, void* ctx)
+{
+	ForecastParser* parser = static_cast<ForecastParser*>(ctx);
+
+	// Every field of interest lives inside a list entry
+	if (type != JsonType::Number || scanner.depth() < 3 || scanner.indexAt(1) < 0)
+		return;
+
+	if (scanner.matches("list[*].dt"))
+	{
+		parser->m_slotAt = strtoll(value, nullptr, 10);
+	}
+	else if (scanner.matches("list[*].main.temp_min") || scanner.matches("list[*].main.temp") ||
+	         scanner.matches("list[*].main.temp_max"))
+	{
+		float temp = strtof(value, nullptr);
+		if (temp < parser->m_slotMin) parser->m_slotMin = temp;
+		if (temp > parser->m_slotMax) parser->m_slotMax = temp;
+	}
+	else if (scanner.matches("list[*].weather[0].id"))
+	{
+		parser->m_slotConditionId = atoi(value);
+	}
+	else if (scanner.matches("list[*].pop"))
+	{
+		parser->m_slotPop = strtof(value, nullptr);
+	}
+}
+
+void OpenWeatherMapProvider::ForecastParser::onContainerEnd(const JsonScanner& scanner, void* ctx)
+{
+	if (scanner.depth() == 2 && scanner.matches("list[*]"))
+	{
+		ForecastParser* parser = static_cast<ForecastParser*>(ctx);
+		parser->foldSlot();
+		parser->resetSlot();
+	}
+}
@@ -27,7 +27,27 @@ void TimeSync::init()
 	esp_sntp_setoperatingmode(SNTP_OPMODE_POLL);
 	esp_sntp_setservername(0, CONFIG_NTP_SERVER);
 	esp_sntp_set_time_sync_notification_cb(timeSyncNotificationCb);
-	esp_sntp_init();
+}
+
+void TimeSync::onConnectivityChange(bool connected, void* ctx)
+{
+	if (connected)
+	{
+		ESP_LOGI(TAG, "Network up, starting SNTP");
+		if (esp_sntp_enabled())
+		{
+			esp_sntp_restart();
+		}
+		else
+		{
+			esp_sntp_init();
+		}
+	}
+	else if (esp_sntp_enabled())
+	{
+		ESP_LOGI(TAG, "Network down, pausing SNTP");
+		esp_sntp_stop();
+	}
 }
 
 void TimeSync::syncTime()
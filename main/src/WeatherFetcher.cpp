@@ -1,142 +1,924 @@
 #include "WeatherFetcher.hpp"
+#include "WifiManager.hpp"
+#include "ConfigManager.hpp"
+#include "OpenWeatherMapProvider.hpp"
+#include "TimeSync.hpp"
 #include "esp_log.h"
 #include "esp_http_client.h"
-#include <cJSON.h>
+#include "esp_timer.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "lwip/netdb.h"
+#include "lwip/sockets.h"
+#include <atomic>
 #include <cstring>
+#include <strings.h>
+#include <cmath>
+#include <ctime>
 
 namespace
 {
 	const char* TAG = "WeatherFetcher";
-	const int MAX_HTTP_OUTPUT_BUFFER = 2048;
-	char httpOutputBuffer[MAX_HTTP_OUTPUT_BUFFER];
-	int httpOutputLen = 0;
+	const uint32_t WEATHER_UPDATE_INTERVAL_MS = 60 * 60 * 1000;  // 1 hour
+	const int64_t WEATHER_STALE_AFTER_S = 3 * 60 * 60;
+
+	// Delay before each retry after consecutive failures; the last entry
+	// repeats until a fetch succeeds
+	const uint32_t RETRY_DELAYS_MS[] = {30000, 60000, 120000, 300000, 600000, 900000};
+	const size_t RETRY_STEPS = sizeof(RETRY_DELAYS_MS) / sizeof(RETRY_DELAYS_MS[0]);
+
+	// One cache entry per location slot: "wcache0", "wcache1", ...
+	const char* CACHE_KEY_FORMAT = "wcache%d";
+	const char* LEGACY_CACHE_KEY = "weather_cache";
+	const uint8_t CACHE_VERSION = 2;
+
+	/**
+	 * @brief NVS layout of a cached observation
+	 */
+	struct WeatherCacheBlob
+	{
+		uint8_t version;
+		char query[DisplayConfig::WEATHER_LOCATION_LEN];
+		WeatherData data;
+	};
+
+	const int LOCATION_SLOTS = DisplayConfig::MAX_WEATHER_LOCATIONS;
+
+	/**
+	 * @brief Schedule and double-buffered results of one distinct location
+	 *
+	 * Identical queries share a slot. A slot keeps its query and data after
+	 * the location is removed, so re-adding it reuses the cache.
+	 */
+	struct LocationSlot
+	{
+		char query[DisplayConfig::WEATHER_LOCATION_LEN];  ///< Guarded by slotsMutex
+		bool active;                                      ///< Guarded by slotsMutex
+		WeatherData weather[2];
+		std::atomic<uint8_t> weatherFront;
+		ForecastData forecast[2];
+		std::atomic<uint8_t> forecastFront;
+		int64_t nextDueUs;   ///< Fetch task only; 0 = not scheduled yet
+		int64_t phaseUs;     ///< Fetch task only; offset of this slot's refreshes within the hour
+		uint8_t failures;    ///< Fetch task only; consecutive failed fetches
+	};
+
+	LocationSlot locationSlots[LOCATION_SLOTS];
+	SemaphoreHandle_t slotsMutex = nullptr;
+	// Start of the hourly grid the slots' phases are measured from; fetch task only
+	int64_t scheduleAnchorUs = 0;
+
+	/**
+	 * First point at or after @p earliest on the slot's hourly grid. Every
+	 * successful fetch reschedules onto the grid, so a burst of fetches
+	 * (boot, a new API key) spreads back out after one round.
+	 */
+	int64_t nextOnGrid(const LocationSlot& slot, int64_t earliest)
+	{
+		const int64_t intervalUs = WEATHER_UPDATE_INTERVAL_MS * 1000LL;
+		int64_t base = scheduleAnchorUs + slot.phaseUs;
+		if (earliest <= base)
+			return base;
+		return base + (earliest - base + intervalUs - 1) / intervalUs * intervalUs;
+	}
+
+	// Caller holds slotsMutex, or is the fetch task (the only writer)
+	LocationSlot* findSlot(const char* query)
+	{
+		for (int i = 0; i < LOCATION_SLOTS; i++)
+		{
+			if (locationSlots[i].query[0] != '\0' && strcasecmp(locationSlots[i].query, query) == 0)
+				return &locationSlots[i];
+		}
+		return nullptr;
+	}
+	const int64_t DNS_CACHE_TTL_US = 24LL * 60 * 60 * 1000 * 1000;
+
+	/**
+	 * @brief Per-request timestamps and captured headers
+	 *
+	 * Filled in by the HTTP event handler while esp_http_client_perform()
+	 * runs; a zero timestamp means the event did not happen.
+	 */
+	struct FetchContext
+	{
+		ResponseParser* parser;
+		int64_t startUs;
+		int64_t connectedUs;
+		int64_t headersSentUs;
+		int64_t firstHeaderUs;
+		int64_t firstDataUs;
+		int64_t finishUs;
+		char etag[64];
+		char lastModified[40];
+	};
+
+	// Only touched by the fetch task. The client is kept across fetches so
+	// the TCP connection is reused while the server allows keep-alive.
+	esp_http_client_handle_t httpClient = nullptr;
+	FetchContext fetchContext = {};
+	OpenWeatherMapProvider openWeatherMap;
+	WeatherProvider* provider = &openWeatherMap;
+
+	// Parsed from CONFIG_WEATHER_API_BASE_URL
+	char apiHost[64] = "";
+	char apiPort[6] = "80";
+	char apiBasePath[64] = "";
+	char hostHeader[72] = "";
+
+	char cachedAddr[16] = "";
+	int64_t addrResolvedUs = 0;
+	uint32_t lastDnsMs = 0;
+
+	/**
+	 * @brief Revalidation state of the last 200 response for a request path
+	 *
+	 * Paths are identified by hash; they embed the API key and location.
+	 */
+	struct Validators
+	{
+		uint32_t pathHash;
+		char etag[64];
+		char lastModified[40];
+	};
+
+	// Current weather and forecast for every location
+	const int VALIDATOR_SLOTS = 2 * LOCATION_SLOTS;
+	Validators validatorSlots[VALIDATOR_SLOTS] = {};
+	int nextValidatorSlot = 0;
+
+	// Split "http://host[:port][/base]" into its parts
+	bool parseBaseUrl(const char* url)
+	{
+		const char* prefix = "http://";
+		if (strncmp(url, prefix, strlen(prefix)) != 0)
+			return false;
+
+		const char* host = url + strlen(prefix);
+		size_t hostLen = strcspn(host, ":/");
+		if (hostLen == 0 || hostLen >= sizeof(apiHost))
+			return false;
+		memcpy(apiHost, host, hostLen);
+		apiHost[hostLen] = '\0';
+
+		const char* rest = host + hostLen;
+		if (*rest == ':')
+		{
+			rest++;
+			size_t portLen = strspn(rest, "0123456789");
+			if (portLen == 0 || portLen >= sizeof(apiPort))
+				return false;
+			memcpy(apiPort, rest, portLen);
+			apiPort[portLen] = '\0';
+			rest += portLen;
+		}
+
+		// Drop a trailing slash; request paths start with one
+		size_t baseLen = strlen(rest);
+		if (baseLen > 0 && rest[baseLen - 1] == '/')
+			baseLen--;
+		if (baseLen >= sizeof(apiBasePath))
+			return false;
+		memcpy(apiBasePath, rest, baseLen);
+		apiBasePath[baseLen] = '\0';
+
+		if (strcmp(apiPort, "80") == 0)
+			snprintf(hostHeader, sizeof(hostHeader), "%s", apiHost);
+		else
+			snprintf(hostHeader, sizeof(hostHeader), "%s:%s", apiHost, apiPort);
+		return true;
+	}
+
+	uint32_t hashPath(const char* path)
+	{
+		// FNV-1a; 0 marks an unused slot
+		uint32_t hash = 2166136261u;
+		for (; *path; path++)
+		{
+			hash = (hash ^ static_cast<uint8_t>(*path)) * 16777619u;
+		}
+		return hash ? hash : 1;
+	}
+
+	Validators* findValidators(const char* path)
+	{
+		uint32_t hash = hashPath(path);
+		for (int i = 0; i < VALIDATOR_SLOTS; i++)
+		{
+			if (validatorSlots[i].pathHash == hash)
+				return &validatorSlots[i];
+		}
+		return nullptr;
+	}
+
+	SemaphoreHandle_t statsMutex = nullptr;
+	WeatherFetchStats fetchStats = {};
+	uint64_t connectMsTotal = 0;
+	uint64_t ttfbMsTotal = 0;
+	uint64_t bodyMsTotal = 0;
+	uint32_t ttfbSamples = 0;
+
+	const char* CONDITION_NAMES[] = {"--", "Storm", "Snow", "Rain", "Drizzle", "Fog", "Clouds", "Clear"};
+	static_assert(sizeof(CONDITION_NAMES) / sizeof(CONDITION_NAMES[0]) == static_cast<int>(WeatherCondition::Count),
+	              "One name per weather condition");
+
+	TaskHandle_t fetchTask = nullptr;
+	std::atomic<bool> networkUp{false};
+}
+
+static void copyHeader(char* dest, size_t size, const char* value)
+{
+	strncpy(dest, value, size - 1);
+	dest[size - 1] = '\0';
 }
 
 esp_err_t httpEventHandler(esp_http_client_event_t *evt)
 {
+	FetchContext* ctx = static_cast<FetchContext*>(evt->user_data);
+	int64_t now = esp_timer_get_time();
+
 	switch(evt->event_id)
 	{
+	case HTTP_EVENT_ON_CONNECTED:
+		// Only raised for a new connection, not when keep-alive reuses one
+		ctx->connectedUs = now;
+		break;
+	case HTTP_EVENT_HEADERS_SENT:
+		ctx->headersSentUs = now;
+		break;
+	case HTTP_EVENT_ON_HEADER:
+		if (ctx->firstHeaderUs == 0)
+		{
+			ctx->firstHeaderUs = now;
+		}
+		if (strcasecmp(evt->header_key, "ETag") == 0)
+		{
+			copyHeader(ctx->etag, sizeof(ctx->etag), evt->header_value);
+		}
+		else if (strcasecmp(evt->header_key, "Last-Modified") == 0)
+		{
+			copyHeader(ctx->lastModified, sizeof(ctx->lastModified), evt->header_value);
+		}
+		break;
 	case HTTP_EVENT_ON_DATA:
-		if (!esp_http_client_is_chunked_response(evt->client))
+		if (ctx->firstDataUs == 0)
 		{
-			if (httpOutputLen + evt->data_len < MAX_HTTP_OUTPUT_BUFFER)
-			{
-				memcpy(httpOutputBuffer + httpOutputLen, evt->data, evt->data_len);
-				httpOutputLen += evt->data_len;
-			}
+			ctx->firstDataUs = now;
+		}
+		// Chunked bodies arrive here already de-chunked, so both transfer
+		// encodings go straight into the parser regardless of size
+		if (esp_http_client_get_status_code(evt->client) == 200)
+		{
+			ctx->parser->feed(static_cast<const char*>(evt->data), evt->data_len);
 		}
 		break;
+	case HTTP_EVENT_ON_FINISH:
+		ctx->finishUs = now;
+		break;
 	default:
 		break;
 	}
 	return ESP_OK;
 }
 
-bool WeatherFetcher::fetchWeather(WeatherData& data, const char* apiKey)
+void WeatherFetcher::start()
 {
-	data.valid = false;
+	if (fetchTask != nullptr)
+		return;
 
-	// Use provided API key or fall back to Kconfig
-	if (!apiKey || strlen(apiKey) == 0)
+	if (!parseBaseUrl(CONFIG_WEATHER_API_BASE_URL))
 	{
-		apiKey = CONFIG_OPENWEATHER_API_KEY;
+		ESP_LOGE(TAG, "Unsupported weather API base URL: %s", CONFIG_WEATHER_API_BASE_URL);
 	}
+	ESP_LOGI(TAG, "Weather provider %s at %s", provider->name(), CONFIG_WEATHER_API_BASE_URL);
 
-	if (strlen(apiKey) == 0)
+	statsMutex = xSemaphoreCreateMutex();
+	slotsMutex = xSemaphoreCreateMutex();
+	loadCache();
+
+	// Match cached slots to the configured locations right away so the
+	// cache is served even before the network comes up
+	DisplayConfig config;
+	ConfigManager::getConfig(config);
+	reconcileLocations(config, false);
+
+	networkUp = WifiManager::isConnected();
+	WifiManager::addConnectivityListener(onConnectivityChange, nullptr);
+	xTaskCreate(taskMain, "weather", 6144, nullptr, 3, &fetchTask);
+}
+
+void WeatherFetcher::requestUpdate()
+{
+	if (fetchTask != nullptr)
 	{
-		ESP_LOGW(TAG, "OpenWeather API key not configured");
+		xTaskNotifyGive(fetchTask);
+	}
+}
+
+void WeatherFetcher::getFetchStats(WeatherFetchStats& stats)
+{
+	if (statsMutex == nullptr)
+	{
+		stats = {};
+		return;
+	}
+
+	xSemaphoreTake(statsMutex, portMAX_DELAY);
+	stats = fetchStats;
+	xSemaphoreGive(statsMutex);
+}
+
+bool WeatherFetcher::getForecast(const char* location, ForecastData& forecast)
+{
+	forecast = {};
+	if (slotsMutex == nullptr)
+		return false;
+
+	xSemaphoreTake(slotsMutex, portMAX_DELAY);
+	LocationSlot* slot = findSlot(location);
+	if (slot && slot->active)
+	{
+		forecast = slot->forecast[slot->forecastFront.load(std::memory_order_acquire)];
+	}
+	xSemaphoreGive(slotsMutex);
+	return forecast.valid;
+}
+
+bool WeatherFetcher::getLatest(const char* location, WeatherData& data)
+{
+	data = {};
+	if (slotsMutex == nullptr)
 		return false;
+
+	// A reader only races the writer if it is preempted for a whole
+	// refresh cycle, since the writer fills the buffer that is not published
+	xSemaphoreTake(slotsMutex, portMAX_DELAY);
+	LocationSlot* slot = findSlot(location);
+	if (slot && slot->active)
+	{
+		data = slot->weather[slot->weatherFront.load(std::memory_order_acquire)];
+	}
+	xSemaphoreGive(slotsMutex);
+	return data.valid;
+}
+
+void WeatherFetcher::onConnectivityChange(bool connected, void* ctx)
+{
+	networkUp = connected;
+
+	// Refresh right after reconnecting; a disconnect just parks the task
+	requestUpdate();
+}
+
+void WeatherFetcher::loadCache()
+{
+	nvs_handle_t nvsHandle;
+	if (nvs_open("storage", NVS_READWRITE, &nvsHandle) != ESP_OK)
+		return;
+
+	// The single-location cache is superseded by per-slot entries
+	if (nvs_erase_key(nvsHandle, LEGACY_CACHE_KEY) == ESP_OK)
+	{
+		nvs_commit(nvsHandle);
 	}
 
-	char url[256];
-	snprintf(url, sizeof(url),
-	         "http://api.openweathermap.org/data/2.5/weather?q=%s,%s&appid=%s&units=metric",
-	         CONFIG_WEATHER_CITY, CONFIG_WEATHER_COUNTRY_CODE, apiKey);
+	for (int i = 0; i < LOCATION_SLOTS; i++)
+	{
+		char key[16];
+		snprintf(key, sizeof(key), CACHE_KEY_FORMAT, i);
+
+		WeatherCacheBlob blob = {};
+		size_t size = sizeof(blob);
+		esp_err_t err = nvs_get_blob(nvsHandle, key, &blob, &size);
+		if (err != ESP_OK || size != sizeof(blob) || blob.version != CACHE_VERSION || !blob.data.valid)
+			continue;
+
+		// Runs before the fetch task exists; slots stay inactive until the
+		// configured locations are matched against them
+		LocationSlot& slot = locationSlots[i];
+		blob.query[sizeof(blob.query) - 1] = '\0';
+		memcpy(slot.query, blob.query, sizeof(slot.query));
+		blob.data.fromCache = true;
+		slot.weather[slot.weatherFront.load(std::memory_order_relaxed)] = blob.data;
+		ESP_LOGI(TAG, "Loaded cached weather for %s observed at %lld", slot.query, (long long)blob.data.observedAt);
+	}
 
-	httpOutputLen = 0;
-	memset(httpOutputBuffer, 0, sizeof(httpOutputBuffer));
+	nvs_close(nvsHandle);
+}
 
-	esp_http_client_config_t config = {};
-	config.url = url;
-	config.event_handler = httpEventHandler;
-	config.timeout_ms = 5000;
+void WeatherFetcher::saveCache(int slotIndex, const WeatherData& data)
+{
+	nvs_handle_t nvsHandle;
+	esp_err_t err = nvs_open("storage", NVS_READWRITE, &nvsHandle);
+	if (err != ESP_OK)
+	{
+		ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
+		return;
+	}
 
-	esp_http_client_handle_t client = esp_http_client_init(&config);
-	esp_err_t err = esp_http_client_perform(client);
+	WeatherCacheBlob blob = {};
+	blob.version = CACHE_VERSION;
+	memcpy(blob.query, locationSlots[slotIndex].query, sizeof(blob.query));
+	blob.data = data;
 
+	char key[16];
+	snprintf(key, sizeof(key), CACHE_KEY_FORMAT, slotIndex);
+	err = nvs_set_blob(nvsHandle, key, &blob, sizeof(blob));
 	if (err == ESP_OK)
 	{
-		int statusCode = esp_http_client_get_status_code(client);
-		if (statusCode == 200)
+		err = nvs_commit(nvsHandle);
+	}
+	if (err != ESP_OK)
+	{
+		ESP_LOGE(TAG, "Error saving weather cache: %s", esp_err_to_name(err));
+	}
+	nvs_close(nvsHandle);
+}
+
+bool WeatherFetcher::isStale(const WeatherData& data)
+{
+	if (!TimeSync::isTimeSynced() || data.observedAt == 0)
+		return data.fromCache;
+
+	return time(nullptr) - data.observedAt > WEATHER_STALE_AFTER_S;
+}
+
+void WeatherFetcher::reconcileLocations(const DisplayConfig& config, bool refreshAll)
+{
+	bool claimed[LOCATION_SLOTS] = {};
+	const char* unmatched[DisplayConfig::MAX_WEATHER_LOCATIONS];
+	int unmatchedCount = 0;
+
+	xSemaphoreTake(slotsMutex, portMAX_DELAY);
+
+	// Keep slots (and their cached data) whose query is still configured;
+	// duplicate queries collapse onto the same slot
+	for (int i = 0; i < config.weatherLocationCount; i++)
+	{
+		LocationSlot* slot = findSlot(config.weatherLocations[i]);
+		if (slot)
 		{
-			httpOutputBuffer[httpOutputLen] = '\0';
-			bool parsed = parseWeatherJSON(httpOutputBuffer, data);
-			esp_http_client_cleanup(client);
-			return parsed;
+			claimed[slot - locationSlots] = true;
+			continue;
 		}
-		else
+
+		bool duplicate = false;
+		for (int j = 0; j < unmatchedCount; j++)
+		{
+			duplicate |= strcasecmp(unmatched[j], config.weatherLocations[i]) == 0;
+		}
+		if (!duplicate)
 		{
-			ESP_LOGW(TAG, "HTTP GET failed, status code: %d", statusCode);
+			unmatched[unmatchedCount++] = config.weatherLocations[i];
 		}
 	}
-	else
+
+	// Hand the remaining slots to new locations, preferring never-used ones
+	for (int j = 0; j < unmatchedCount; j++)
 	{
-		ESP_LOGE(TAG, "HTTP GET request failed: %s", esp_err_to_name(err));
+		int pick = -1;
+		for (int i = 0; i < LOCATION_SLOTS; i++)
+		{
+			if (claimed[i])
+				continue;
+			if (pick < 0 || (locationSlots[i].query[0] == '\0' && locationSlots[pick].query[0] != '\0'))
+				pick = i;
+		}
+		if (pick < 0)
+			break;
+
+		LocationSlot& slot = locationSlots[pick];
+		claimed[pick] = true;
+		strncpy(slot.query, unmatched[j], sizeof(slot.query) - 1);
+		slot.query[sizeof(slot.query) - 1] = '\0';
+		slot.weather[0] = {};
+		slot.weather[1] = {};
+		slot.forecast[0] = {};
+		slot.forecast[1] = {};
+		slot.nextDueUs = 0;
+		slot.failures = 0;
+	}
+
+	for (int i = 0; i < LOCATION_SLOTS; i++)
+	{
+		locationSlots[i].active = claimed[i];
+	}
+
+	xSemaphoreGive(slotsMutex);
+
+	// Give every slot its own phase so refreshes are spread over the hour.
+	// Newly scheduled slots with fresh data wait for their phase; slots
+	// without it are fetched now and join their phase after that fetch.
+	int64_t now = esp_timer_get_time();
+	if (scheduleAnchorUs == 0)
+	{
+		scheduleAnchorUs = now;
+	}
+	int activeCount = 0;
+	for (int i = 0; i < LOCATION_SLOTS; i++)
+	{
+		activeCount += claimed[i] ? 1 : 0;
 	}
+	int64_t spacingUs = activeCount > 0 ? WEATHER_UPDATE_INTERVAL_MS * 1000LL / activeCount : 0;
+
+	int position = 0;
+	for (int i = 0; i < LOCATION_SLOTS; i++)
+	{
+		LocationSlot& slot = locationSlots[i];
+		if (!claimed[i])
+			continue;
 
-	esp_http_client_cleanup(client);
-	return false;
+		slot.phaseUs = position * spacingUs;
+		if (refreshAll || slot.nextDueUs == 0)
+		{
+			const WeatherData& current = slot.weather[slot.weatherFront.load(std::memory_order_relaxed)];
+			bool needsData = refreshAll || !current.valid || isStale(current);
+			slot.nextDueUs = needsData ? now : nextOnGrid(slot, now);
+			slot.failures = 0;
+		}
+		position++;
+	}
 }
 
-bool WeatherFetcher::parseWeatherJSON(const char* json, WeatherData& data)
+void WeatherFetcher::refreshLocation(int slotIndex, const DisplayConfig& config)
 {
-	cJSON* root = cJSON_Parse(json);
-	if (root == NULL)
+	LocationSlot& slot = locationSlots[slotIndex];
+	bool failed = false;
+
+	if (config.showWeather)
 	{
-		ESP_LOGE(TAG, "Failed to parse JSON");
-		return false;
+		WeatherData fresh = {};
+		bool haveData = slot.weather[slot.weatherFront.load(std::memory_order_relaxed)].valid;
+		FetchResult result = fetchWeather(slot.query, fresh, config.weatherApiKey, haveData);
+		if (result == FetchResult::Updated)
+		{
+			uint8_t back = slot.weatherFront.load(std::memory_order_relaxed) ^ 1;
+			slot.weather[back] = fresh;
+			slot.weatherFront.store(back, std::memory_order_release);
+			saveCache(slotIndex, fresh);
+		}
+		failed |= (result == FetchResult::Failed);
 	}
 
-	// Parse temperature from main.temp
-	cJSON* main = cJSON_GetObjectItem(root, "main");
-	if (main)
+	if (config.showForecast)
 	{
-		cJSON* temp = cJSON_GetObjectItem(main, "temp");
-		cJSON* humidity = cJSON_GetObjectItem(main, "humidity");
+		ForecastData fresh;
+		bool haveData = slot.forecast[slot.forecastFront.load(std::memory_order_relaxed)].valid;
+		FetchResult result = fetchForecast(slot.query, fresh, config.weatherApiKey, haveData);
+		if (result == FetchResult::Updated)
+		{
+			uint8_t back = slot.forecastFront.load(std::memory_order_relaxed) ^ 1;
+			slot.forecast[back] = fresh;
+			slot.forecastFront.store(back, std::memory_order_release);
+		}
+		failed |= (result == FetchResult::Failed);
+	}
 
-		if (temp) data.temperature = temp->valuedouble;
-		if (humidity) data.humidity = humidity->valueint;
+	int64_t now = esp_timer_get_time();
+	if (failed)
+	{
+		// Keep showing the last good data and retry well before the
+		// next hourly refresh would
+		uint32_t delayMs = RETRY_DELAYS_MS[slot.failures < RETRY_STEPS ? slot.failures : RETRY_STEPS - 1];
+		if (slot.failures < UINT8_MAX) slot.failures++;
+		ESP_LOGW(TAG, "Fetch for %s failed (%u in a row), retrying in %lu s",
+		         slot.query, (unsigned)slot.failures, (unsigned long)(delayMs / 1000));
+		slot.nextDueUs = now + delayMs * 1000LL;
+	}
+	else
+	{
+		// Back onto the slot's phase, at least half an interval from now
+		slot.failures = 0;
+		slot.nextDueUs = nextOnGrid(slot, now + WEATHER_UPDATE_INTERVAL_MS * 500LL);
 	}
+}
 
-	// Parse description from weather[0].description
-	cJSON* weather = cJSON_GetObjectItem(root, "weather");
-	if (weather && cJSON_IsArray(weather))
+void WeatherFetcher::taskMain(void* arg)
+{
+	TickType_t wait = 0;
+	bool hadWeather = false;
+	bool hadForecast = false;
+	char lastApiKey[sizeof(DisplayConfig::weatherApiKey)] = "";
+
+	for (;;)
 	{
-		cJSON* weatherItem = cJSON_GetArrayItem(weather, 0);
-		if (weatherItem)
+		ulTaskNotifyTake(pdTRUE, wait);
+
+		if (!networkUp)
 		{
-			cJSON* desc = cJSON_GetObjectItem(weatherItem, "description");
-			cJSON* icon = cJSON_GetObjectItem(weatherItem, "icon");
+			// Paused until onConnectivityChange() reports the link is back
+			wait = portMAX_DELAY;
+			continue;
+		}
 
-			if (desc && cJSON_IsString(desc))
+		DisplayConfig config;
+		ConfigManager::getConfig(config);
+		if (!config.showWeather && !config.showForecast)
+		{
+			// Idle until requestUpdate() after a weather mode is enabled
+			hadWeather = false;
+			hadForecast = false;
+			wait = portMAX_DELAY;
+			continue;
+		}
+
+		// A newly enabled mode or a new key makes every location due now;
+		// otherwise only added locations are scheduled
+		bool refreshAll = (config.showWeather && !hadWeather) ||
+		                  (config.showForecast && !hadForecast) ||
+		                  strcmp(lastApiKey, config.weatherApiKey) != 0;
+		hadWeather = config.showWeather;
+		hadForecast = config.showForecast;
+		memcpy(lastApiKey, config.weatherApiKey, sizeof(lastApiKey));
+
+		reconcileLocations(config, refreshAll);
+
+		// One location at a time, in due order, sharing one connection
+		int64_t nextDueUs = INT64_MAX;
+		for (int i = 0; i < LOCATION_SLOTS; i++)
+		{
+			if (!locationSlots[i].active)
+				continue;
+
+			if (locationSlots[i].nextDueUs <= esp_timer_get_time())
 			{
-				strncpy(data.description, desc->valuestring, sizeof(data.description) - 1);
+				refreshLocation(i, config);
 			}
-
-			if (icon && cJSON_IsString(icon))
+			if (locationSlots[i].nextDueUs < nextDueUs)
 			{
-				strncpy(data.icon, icon->valuestring, sizeof(data.icon) - 1);
+				nextDueUs = locationSlots[i].nextDueUs;
 			}
 		}
+
+		int64_t delayUs = nextDueUs - esp_timer_get_time();
+		wait = (nextDueUs == INT64_MAX) ? portMAX_DELAY : pdMS_TO_TICKS(delayUs > 0 ? delayUs / 1000 + 1 : 0);
 	}
+}
 
-	data.valid = true;
-	cJSON_Delete(root);
+bool WeatherFetcher::resolveHost()
+{
+	if (cachedAddr[0] != '\0' && esp_timer_get_time() - addrResolvedUs < DNS_CACHE_TTL_US)
+	{
+		lastDnsMs = 0;
+		return true;
+	}
+
+	if (apiHost[0] == '\0')
+		return false;
+
+	struct addrinfo hints = {};
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	struct addrinfo* result = nullptr;
+
+	int64_t startUs = esp_timer_get_time();
+	int err = getaddrinfo(apiHost, apiPort, &hints, &result);
+	if (err != 0 || result == nullptr)
+	{
+		ESP_LOGE(TAG, "DNS lookup for %s failed: %d", apiHost, err);
+		return false;
+	}
 
-	ESP_LOGI(TAG, "Weather: %.1f°C, %d%%, %s", data.temperature, data.humidity, data.description);
+	struct sockaddr_in* addr = reinterpret_cast<struct sockaddr_in*>(result->ai_addr);
+	inet_ntop(AF_INET, &addr->sin_addr, cachedAddr, sizeof(cachedAddr));
+	freeaddrinfo(result);
+
+	addrResolvedUs = esp_timer_get_time();
+	lastDnsMs = static_cast<uint32_t>((addrResolvedUs - startUs) / 1000);
+	ESP_LOGI(TAG, "%s resolved to %s in %lu ms", apiHost, cachedAddr, (unsigned long)lastDnsMs);
 	return true;
 }
 
+void WeatherFetcher::recordFetch(FetchResult result)
+{
+	const FetchContext& ctx = fetchContext;
+	int64_t endUs = ctx.finishUs ? ctx.finishUs : esp_timer_get_time();
+
+	xSemaphoreTake(statsMutex, portMAX_DELAY);
+
+	fetchStats.fetches++;
+	if (result == FetchResult::Failed) fetchStats.failures++;
+	if (result == FetchResult::NotModified) fetchStats.notModified++;
+
+	fetchStats.lastDnsMs = lastDnsMs;
+	fetchStats.lastReused = (ctx.connectedUs == 0);
+	if (ctx.connectedUs != 0)
+	{
+		fetchStats.lastConnectMs = lastDnsMs + static_cast<uint32_t>((ctx.connectedUs - ctx.startUs) / 1000);
+		fetchStats.newConnections++;
+		connectMsTotal += fetchStats.lastConnectMs;
+		fetchStats.avgConnectMs = connectMsTotal / fetchStats.newConnections;
+	}
+	else
+	{
+		fetchStats.lastConnectMs = 0;
+		fetchStats.reusedConnections++;
+	}
+
+	if (ctx.headersSentUs != 0 && ctx.firstHeaderUs != 0)
+	{
+		fetchStats.lastTtfbMs = static_cast<uint32_t>((ctx.firstHeaderUs - ctx.headersSentUs) / 1000);
+		fetchStats.lastBodyMs = ctx.firstDataUs ? static_cast<uint32_t>((endUs - ctx.firstDataUs) / 1000) : 0;
+		ttfbSamples++;
+		ttfbMsTotal += fetchStats.lastTtfbMs;
+		bodyMsTotal += fetchStats.lastBodyMs;
+		fetchStats.avgTtfbMs = ttfbMsTotal / ttfbSamples;
+		fetchStats.avgBodyMs = bodyMsTotal / ttfbSamples;
+	}
+	fetchStats.lastTotalMs = lastDnsMs + static_cast<uint32_t>((endUs - ctx.startUs) / 1000);
+
+	ESP_LOGI(TAG, "Fetch %s: dns %lu ms, connect %lu ms%s, ttfb %lu ms, body %lu ms",
+	         result == FetchResult::Updated ? "updated" : result == FetchResult::NotModified ? "not modified" : "failed",
+	         (unsigned long)fetchStats.lastDnsMs, (unsigned long)fetchStats.lastConnectMs,
+	         fetchStats.lastReused ? " (reused)" : "",
+	         (unsigned long)fetchStats.lastTtfbMs, (unsigned long)fetchStats.lastBodyMs);
+
+	xSemaphoreGive(statsMutex);
+}
+
+const char* WeatherFetcher::resolveApiKey(const char* apiKey)
+{
+	// Use provided API key or fall back to Kconfig
+	if (!apiKey || strlen(apiKey) == 0)
+	{
+		apiKey = CONFIG_OPENWEATHER_API_KEY;
+	}
+
+	if (strlen(apiKey) == 0)
+	{
+		ESP_LOGW(TAG, "OpenWeather API key not configured");
+		return nullptr;
+	}
+	return apiKey;
+}
+
+WeatherFetcher::FetchResult WeatherFetcher::fetchWeather(const char* location, WeatherData& data, const char* apiKey,
+                                                         bool revalidate)
+{
+	data.valid = false;
+
+	apiKey = resolveApiKey(apiKey);
+	char path[256];
+	if (apiKey == nullptr || !provider->currentPath(location, apiKey, path, sizeof(path)))
+	{
+		return FetchResult::Failed;
+	}
+
+	ResponseParser& parser = provider->beginCurrent(data);
+	FetchResult result = performRequest(path, parser, revalidate);
+	if (result == FetchResult::Updated)
+	{
+		if (parser.finish())
+		{
+			if (data.observedAt == 0 && TimeSync::isTimeSynced())
+			{
+				data.observedAt = time(nullptr);
+			}
+			ESP_LOGI(TAG, "Weather for %s: %.1f°C, %d%%, %s", location, data.temperature, data.humidity, data.description);
+		}
+		else
+		{
+			ESP_LOGE(TAG, "Failed to parse %s weather response", provider->name());
+			result = FetchResult::Failed;
+		}
+	}
+	finishRequest(path, result);
+	return result;
+}
+
+WeatherFetcher::FetchResult WeatherFetcher::fetchForecast(const char* location, ForecastData& forecast, const char* apiKey,
+                                                          bool revalidate)
+{
+	forecast = {};
+
+	apiKey = resolveApiKey(apiKey);
+	char path[256];
+	if (apiKey == nullptr || !provider->forecastPath(location, apiKey, path, sizeof(path)))
+	{
+		return FetchResult::Failed;
+	}
+
+	ResponseParser& parser = provider->beginForecast(forecast);
+	FetchResult result = performRequest(path, parser, revalidate);
+	if (result == FetchResult::Updated)
+	{
+		if (parser.finish())
+		{
+			ESP_LOGI(TAG, "Forecast for %s: %d days", location, forecast.dayCount);
+		}
+		else
+		{
+			ESP_LOGE(TAG, "Failed to parse %s forecast response", provider->name());
+			result = FetchResult::Failed;
+		}
+	}
+	finishRequest(path, result);
+	return result;
+}
+
+WeatherFetcher::FetchResult WeatherFetcher::performRequest(const char* path, ResponseParser& parser, bool revalidate)
+{
+	fetchContext = {};
+	lastDnsMs = 0;
+
+	if (!resolveHost())
+	{
+		return FetchResult::Failed;
+	}
+
+	// Connect to the cached address directly; the Host header keeps
+	// virtual hosting working without a DNS lookup per request
+	char url[352];
+	snprintf(url, sizeof(url), "http://%s:%s%s%s", cachedAddr, apiPort, apiBasePath, path);
+
+	if (httpClient == nullptr)
+	{
+		esp_http_client_config_t config = {};
+		config.url = url;
+		config.event_handler = httpEventHandler;
+		config.user_data = &fetchContext;
+		config.timeout_ms = 5000;
+		config.keep_alive_enable = true;
+		httpClient = esp_http_client_init(&config);
+		if (httpClient == nullptr)
+		{
+			ESP_LOGE(TAG, "Failed to create HTTP client");
+			return FetchResult::Failed;
+		}
+	}
+	else
+	{
+		esp_http_client_set_url(httpClient, url);
+	}
+	esp_http_client_set_header(httpClient, "Host", hostHeader);
+
+	// Revalidate only against validators that belong to this exact request,
+	// and only if the caller still has the data a 304 would tell it to keep
+	const Validators* validators = revalidate ? findValidators(path) : nullptr;
+	if (validators && validators->etag[0] != '\0')
+		esp_http_client_set_header(httpClient, "If-None-Match", validators->etag);
+	else
+		esp_http_client_delete_header(httpClient, "If-None-Match");
+
+	if (validators && validators->lastModified[0] != '\0')
+		esp_http_client_set_header(httpClient, "If-Modified-Since", validators->lastModified);
+	else
+		esp_http_client_delete_header(httpClient, "If-Modified-Since");
+
+	fetchContext.parser = &parser;
+	fetchContext.startUs = esp_timer_get_time();
+
+	esp_err_t err = esp_http_client_perform(httpClient);
+	if (err != ESP_OK)
+	{
+		ESP_LOGE(TAG, "HTTP GET request failed: %s", esp_err_to_name(err));
+		// Drop the connection and look the host up again next time
+		esp_http_client_close(httpClient);
+		cachedAddr[0] = '\0';
+		return FetchResult::Failed;
+	}
+
+	WifiManager::recordRequestLatency(WifiManager::RequestDirection::Outbound,
+	                                  static_cast<uint32_t>((esp_timer_get_time() - fetchContext.startUs) / 1000));
+
+	int statusCode = esp_http_client_get_status_code(httpClient);
+	if (statusCode == 304)
+	{
+		ESP_LOGI(TAG, "Not modified: %.*s", static_cast<int>(strcspn(path, "?")), path);
+		return FetchResult::NotModified;
+	}
+	if (statusCode == 200)
+	{
+		return FetchResult::Updated;
+	}
+
+	ESP_LOGW(TAG, "HTTP GET failed, status code: %d", statusCode);
+	return FetchResult::Failed;
+}
+
+void WeatherFetcher::finishRequest(const char* path, FetchResult result)
+{
+	if (result == FetchResult::Updated)
+	{
+		Validators* validators = findValidators(path);
+		if (validators == nullptr)
+		{
+			validators = &validatorSlots[nextValidatorSlot];
+			nextValidatorSlot = (nextValidatorSlot + 1) % VALIDATOR_SLOTS;
+		}
+		validators->pathHash = hashPath(path);
+		copyHeader(validators->etag, sizeof(validators->etag), fetchContext.etag);
+		copyHeader(validators->lastModified, sizeof(validators->lastModified), fetchContext.lastModified);
+	}
+
+	if (fetchContext.startUs != 0)
+	{
+		recordFetch(result);
+	}
+}
+
 void WeatherFetcher::formatWeatherString(const WeatherData& data, char* buffer, size_t size)
 {
 	if (!data.valid)
@@ -145,5 +927,70 @@ void WeatherFetcher::formatWeatherString(const WeatherData& data, char* buffer,
 		return;
 	}
 
-	snprintf(buffer, size, "%.1fC %d%% %s", data.temperature, data.humidity, data.description);
+	int len = snprintf(buffer, size, "%.1fC %d%% %s", data.temperature, data.humidity, data.description);
+	if (len < 0 || static_cast<size_t>(len) >= size || !isStale(data))
+		return;
+
+	if (TimeSync::isTimeSynced() && data.observedAt != 0)
+	{
+		long hours = static_cast<long>((time(nullptr) - data.observedAt) / 3600);
+		snprintf(buffer + len, size - len, " (%ldh ago)", hours);
+	}
+	else
+	{
+		snprintf(buffer + len, size - len, " (cached)");
+	}
+}
+
+void WeatherFetcher::formatForecastString(const ForecastData& forecast, char* buffer, size_t size)
+{
+	if (!forecast.valid)
+	{
+		snprintf(buffer, size, "Forecast: N/A");
+		return;
+	}
+
+	int32_t today = 0;
+	if (TimeSync::isTimeSynced())
+	{
+		today = ForecastData::dayKeyFor(time(nullptr));
+	}
+
+	size_t len = 0;
+	int shown = 0;
+	buffer[0] = '\0';
+
+	for (int i = 0; i < forecast.dayCount && shown < ForecastData::SHOWN_DAYS; i++)
+	{
+		const ForecastDay& day = forecast.days[i];
+		if (day.dayKey < today)
+			continue;
+
+		char label[8];
+		if (day.dayKey == today)
+		{
+			snprintf(label, sizeof(label), "Today");
+		}
+		else
+		{
+			time_t t = static_cast<time_t>(day.firstSlotAt);
+			struct tm timeinfo;
+			localtime_r(&t, &timeinfo);
+			strftime(label, sizeof(label), "%a", &timeinfo);
+		}
+
+		int written = snprintf(buffer + len, size - len, "%s%s %d/%dC %s %d%%",
+		                       shown > 0 ? "  " : "", label,
+		                       static_cast<int>(lroundf(day.maxTemp)), static_cast<int>(lroundf(day.minTemp)),
+		                       CONDITION_NAMES[static_cast<int>(day.condition)], day.precipChance);
+		if (written < 0 || len + written >= size)
+			break;
+		len += written;
+		shown++;
+	}
+
+	if (shown == 0)
+	{
+		snprintf(buffer, size, "Forecast: N/A");
+	}
 }
@@ -1,204 +1,953 @@
 #include "WebServer.hpp"
 #include "WifiManager.hpp"
 #include "ConfigManager.hpp"
+#include "DisplayController.hpp"
+#include "WeatherFetcher.hpp"
+#include "JsonScanner.hpp"
+#include "JsonWriter.hpp"
+#include "MessageQueue.hpp"
+#include "WebAssets.hpp"
+#include "esp_heap_caps.h"
 #include "esp_log.h"
+#include "esp_random.h"
 #include "esp_system.h"
-#include <string>
-#include <cJSON.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <cinttypes>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 
 namespace
 {
 	const char* TAG = "WebServer";
 	httpd_handle_t server = nullptr;
 
-	// Declare symbols created by `EMBED_FILES`
-	extern const uint8_t index_html_start[] asm("_binary_index_html_start");
-	extern const uint8_t index_html_end[]   asm("_binary_index_html_end");
+	// JsonWriter flush target: each full buffer goes out as one HTTP chunk
+	bool sendJsonChunk(const char* data, size_t len, void* ctx)
+	{
+		return httpd_resp_send_chunk(static_cast<httpd_req_t*>(ctx), data, len) == ESP_OK;
+	}
+
+	// Flush the document and terminate the chunked response
+	esp_err_t finishJson(httpd_req_t* req, JsonWriter& json)
+	{
+		if (!json.finish())
+		{
+			ESP_LOGW(TAG, "JSON response aborted");
+			return ESP_FAIL;
+		}
+		return httpd_resp_send_chunk(req, nullptr, 0);
+	}
+
+	// Copy a request header, accepting a truncated value
+	bool getHeader(httpd_req_t* req, const char* name, char* value, size_t size)
+	{
+		esp_err_t err = httpd_req_get_hdr_value_str(req, name, value, size);
+		return err == ESP_OK || err == ESP_ERR_HTTPD_RESULT_TRUNC;
+	}
+
+	const WebAsset* findAsset(const char* uri)
+	{
+		size_t len = strcspn(uri, "?");
+		for (size_t i = 0; i < WEB_ASSET_COUNT; i++)
+		{
+			const char* path = WEB_ASSETS[i].path;
+			if (strlen(path) == len && strncmp(path, uri, len) == 0)
+				return &WEB_ASSETS[i];
+		}
+		return nullptr;
+	}
+
+	// Shared by GET /api/config and the config spliced into the page
+	void writeConfig(JsonWriter& json, const DisplayConfig& config)
+	{
+		json.beginObject();
+		json.addBool("showClock", config.showClock);
+		json.addBool("showWeather", config.showWeather);
+		json.addBool("showForecast", config.showForecast);
+		json.addBool("showStarWars", config.showStarWarsQuotes);
+		json.addBool("showLOTR", config.showLOTRQuotes);
+		json.addBool("displayFlipped", config.displayFlipped);
+		json.addInt("brightness", config.brightness);
+		json.addInt("nightStart", config.nightStartHour);
+		json.addInt("nightEnd", config.nightEndHour);
+		json.addString("customText", config.customText);
+		json.addString("weatherApiKey", config.weatherApiKey);
+
+		json.beginArray("weatherLocations");
+		for (int i = 0; i < config.weatherLocationCount; i++)
+		{
+			json.addString(nullptr, config.weatherLocations[i]);
+		}
+		json.endArray();
+		json.endObject();
+	}
+
+	/**
+	 * Rendered config JSON, valid while its version matches the store's
+	 * (0 = empty). Only touched from the httpd task.
+	 */
+	struct ConfigJsonCache
+	{
+		uint32_t version;
+		size_t len;
+		char json[1024];
+	};
+
+	ConfigJsonCache configCache = {};
+
+	// Random per boot, so an ETag from before a restart never matches
+	uint32_t configEtagSeed = 0;
+
+	bool appendToCache(const char* data, size_t len, void* ctx)
+	{
+		ConfigJsonCache& cache = *static_cast<ConfigJsonCache*>(ctx);
+		if (cache.len + len > sizeof(cache.json))
+			return false;
+		memcpy(cache.json + cache.len, data, len);
+		cache.len += len;
+		return true;
+	}
+
+	// Strong validator for the config at @p version; @p prefix (a quoted ETag) ties it to a page
+	void formatConfigEtag(char* etag, size_t size, uint32_t version, const char* prefix = nullptr)
+	{
+		if (prefix != nullptr)
+		{
+			int prefixLen = static_cast<int>(strlen(prefix)) - 2;
+			snprintf(etag, size, "\"%.*s-%08" PRIx32 "-%" PRIu32 "\"", prefixLen, prefix + 1, configEtagSeed, version);
+		}
+		else
+		{
+			snprintf(etag, size, "\"%08" PRIx32 "-%" PRIu32 "\"", configEtagSeed, version);
+		}
+	}
+
+	bool etagMatches(httpd_req_t* req, const char* etag)
+	{
+		char value[80];
+		return getHeader(req, "If-None-Match", value, sizeof(value)) && strstr(value, etag) != nullptr;
+	}
+
+	/**
+	 * Take one snapshot of the config for a response. The returned version
+	 * names exactly the document that sendConfigJson() then sends, so the
+	 * ETag never runs ahead of or behind the body. Renders the cache when
+	 * stale; a document too large for the cache is left in @p config to
+	 * be streamed instead.
+	 */
+	uint32_t snapshotConfig(DisplayConfig& config)
+	{
+		uint32_t version = ConfigManager::getVersion();
+		if (configCache.version == version)
+			return version;
+
+		version = ConfigManager::getConfig(config);
+		configCache.len = 0;
+		JsonWriter cacheWriter(appendToCache, &configCache);
+		writeConfig(cacheWriter, config);
+		configCache.version = cacheWriter.finish() ? version : 0;
+		return version;
+	}
+
+	/**
+	 * Send the config JSON snapshotted by snapshotConfig() as response chunk(s)
+	 */
+	bool sendConfigJson(httpd_req_t* req, const DisplayConfig& config, uint32_t version)
+	{
+		if (configCache.version != version)
+		{
+			JsonWriter json(sendJsonChunk, req);
+			writeConfig(json, config);
+			return json.finish();
+		}
+		return httpd_resp_send_chunk(req, configCache.json, configCache.len) == ESP_OK;
+	}
+
+	/**
+	 * Send a page template with the current config spliced in. The static
+	 * halves go out straight from flash and the JSON from the config cache.
+	 * The ETag combines the template hash with the config version.
+	 */
+	esp_err_t sendPageWithConfig(httpd_req_t* req, const WebAsset& page)
+	{
+		DisplayConfig config;
+		uint32_t version = snapshotConfig(config);
+		char etag[48];
+		formatConfigEtag(etag, sizeof(etag), version, page.etag);
+
+		httpd_resp_set_hdr(req, "ETag", etag);
+		httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+		if (etagMatches(req, etag))
+		{
+			httpd_resp_set_status(req, "304 Not Modified");
+			return httpd_resp_send(req, nullptr, 0);
+		}
+
+		httpd_resp_set_type(req, page.contentType);
+		const char* data = reinterpret_cast<const char*>(page.data);
+		if (httpd_resp_send_chunk(req, data, page.spliceOffset) != ESP_OK ||
+		    !sendConfigJson(req, config, version) ||
+		    httpd_resp_send_chunk(req, data + page.spliceOffset, page.len - page.spliceOffset) != ESP_OK)
+		{
+			return ESP_FAIL;
+		}
+		return httpd_resp_send_chunk(req, nullptr, 0);
+	}
 
-	// Handler to serve the embedded index.html at "/"
-	esp_err_t rootHandler(httpd_req_t* req)
+	// Handler to serve the embedded web UI at "/" and "/assets/*"
+	esp_err_t assetHandler(httpd_req_t* req)
 	{
-		size_t htmlLen = index_html_end - index_html_start;
-		httpd_resp_set_type(req, "text/html");
-		return httpd_resp_send(req, reinterpret_cast<const char*>(index_html_start), htmlLen);
+		const WebAsset* asset = findAsset(req->uri);
+		if (asset == nullptr)
+		{
+			httpd_resp_send_404(req);
+			return ESP_FAIL;
+		}
+
+		if (asset->spliceOffset != 0)
+			return sendPageWithConfig(req, *asset);
+
+		// Hashed assets never change under their name
+		httpd_resp_set_hdr(req, "ETag", asset->etag);
+		httpd_resp_set_hdr(req, "Cache-Control", asset->immutable ? "public, max-age=31536000, immutable" : "no-cache");
+		httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+
+		if (etagMatches(req, asset->etag))
+		{
+			httpd_resp_set_status(req, "304 Not Modified");
+			return httpd_resp_send(req, nullptr, 0);
+		}
+
+		char value[80];
+		httpd_resp_set_type(req, asset->contentType);
+		if (getHeader(req, "Accept-Encoding", value, sizeof(value)) && strstr(value, "gzip") != nullptr)
+		{
+			httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+			return httpd_resp_send(req, reinterpret_cast<const char*>(asset->gzipData), asset->gzipLen);
+		}
+		return httpd_resp_send(req, reinterpret_cast<const char*>(asset->data), asset->len);
 	}
 
 	// Handler to get current configuration
 	esp_err_t configGetHandler(httpd_req_t* req)
 	{
 		DisplayConfig config;
-		ConfigManager::loadConfig(config);
-
-		cJSON* root = cJSON_CreateObject();
-		cJSON_AddBoolToObject(root, "showClock", config.showClock);
-		cJSON_AddBoolToObject(root, "showWeather", config.showWeather);
-		cJSON_AddBoolToObject(root, "showStarWars", config.showStarWarsQuotes);
-		cJSON_AddBoolToObject(root, "showLOTR", config.showLOTRQuotes);
-		cJSON_AddBoolToObject(root, "displayFlipped", config.displayFlipped);
-		cJSON_AddNumberToObject(root, "brightness", config.brightness);
-		cJSON_AddStringToObject(root, "customText", config.customText);
-		cJSON_AddStringToObject(root, "weatherApiKey", config.weatherApiKey);
-
-		char* jsonStr = cJSON_Print(root);
+		uint32_t version = snapshotConfig(config);
+		char etag[24];
+		formatConfigEtag(etag, sizeof(etag), version);
+
+		httpd_resp_set_hdr(req, "ETag", etag);
+		httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+		if (etagMatches(req, etag))
+		{
+			httpd_resp_set_status(req, "304 Not Modified");
+			return httpd_resp_send(req, nullptr, 0);
+		}
+
 		httpd_resp_set_type(req, "application/json");
-		httpd_resp_send(req, jsonStr, strlen(jsonStr));
+		if (!sendConfigJson(req, config, version))
+			return ESP_FAIL;
+		return httpd_resp_send_chunk(req, nullptr, 0);
+	}
+
+	// Largest request body the POST handlers accept
+	const size_t MAX_BODY_LEN = 4096;
+
+	/**
+	 * Receive the request body in fixed-size pieces and feed each one to
+	 * @p scanner, so bodies of any length (and split across TCP segments)
+	 * are parsed in constant memory. Sends the error response itself.
+	 */
+	esp_err_t scanJsonBody(httpd_req_t* req, JsonScanner& scanner)
+	{
+		if (req->content_len == 0)
+		{
+			httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Empty body");
+			return ESP_FAIL;
+		}
+		if (req->content_len > MAX_BODY_LEN)
+		{
+			httpd_resp_send_err(req, HTTPD_413_CONTENT_TOO_LARGE, "Body too large");
+			return ESP_FAIL;
+		}
+
+		char buf[128];
+		size_t remaining = req->content_len;
+		int timeouts = 0;
+
+		while (remaining > 0)
+		{
+			int ret = httpd_req_recv(req, buf, remaining < sizeof(buf) ? remaining : sizeof(buf));
+			if (ret == HTTPD_SOCK_ERR_TIMEOUT && ++timeouts < 3)
+				continue;
+
+			if (ret <= 0)
+			{
+				if (ret == HTTPD_SOCK_ERR_TIMEOUT)
+				{
+					httpd_resp_send_408(req);
+				}
+				return ESP_FAIL;
+			}
+
+			if (!scanner.feed(buf, ret))
+			{
+				httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Malformed JSON");
+				return ESP_FAIL;
+			}
+			// No field we accept has a key this long; don't apply a body
+			// that we could only partly understand
+			if (scanner.hasTruncatedKey())
+			{
+				httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Key too long");
+				return ESP_FAIL;
+			}
+			remaining -= ret;
+		}
 
-		free(jsonStr);
-		cJSON_Delete(root);
+		if (!scanner.isComplete())
+		{
+			httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Incomplete JSON");
+			return ESP_FAIL;
+		}
 		return ESP_OK;
 	}
 
-	// Handler to save configuration
-	esp_err_t configPostHandler(httpd_req_t* req)
+	bool isTrue(JsonType type, const char* value)
 	{
-		char buf[512];
-		int ret = httpd_req_recv(req, buf, sizeof(buf) - 1);
-		if (ret <= 0)
+		return type == JsonType::Bool && value[0] == 't';
+	}
+
+	// Copy a string field, leaving @p dest untouched for other types
+	void copyString(char* dest, size_t size, JsonType type, const char* value)
+	{
+		if (type != JsonType::String)
+			return;
+		strncpy(dest, value, size - 1);
+		dest[size - 1] = '\0';
+	}
+
+	struct ConfigUpdate
+	{
+		DisplayConfig config;
+		char locations[DisplayConfig::MAX_WEATHER_LOCATIONS][DisplayConfig::WEATHER_LOCATION_LEN];
+		int locationCount;
+		bool locationsSeen;
+	};
+
+	void onConfigValue(const JsonScanner& scanner, JsonType type, const char* value, void* ctx)
+	{
+		ConfigUpdate& update = *static_cast<ConfigUpdate*>(ctx);
+		DisplayConfig& config = update.config;
+
+		if (scanner.depth() == 2)
 		{
-			if (ret == HTTPD_SOCK_ERR_TIMEOUT)
+			if (scanner.matches("weatherLocations[*]") && type == JsonType::String &&
+			    update.locationCount < DisplayConfig::MAX_WEATHER_LOCATIONS)
 			{
-				httpd_resp_send_408(req);
+				copyString(update.locations[update.locationCount++], DisplayConfig::WEATHER_LOCATION_LEN, type, value);
+			}
+			return;
+		}
+
+		if (scanner.depth() != 1)
+			return;
+
+		if (scanner.matches("showClock")) config.showClock = isTrue(type, value);
+		else if (scanner.matches("showWeather")) config.showWeather = isTrue(type, value);
+		else if (scanner.matches("showForecast")) config.showForecast = isTrue(type, value);
+		else if (scanner.matches("showStarWars")) config.showStarWarsQuotes = isTrue(type, value);
+		else if (scanner.matches("showLOTR")) config.showLOTRQuotes = isTrue(type, value);
+		else if (scanner.matches("displayFlipped")) config.displayFlipped = isTrue(type, value);
+		else if (scanner.matches("customText")) copyString(config.customText, sizeof(config.customText), type, value);
+		else if (scanner.matches("weatherApiKey")) copyString(config.weatherApiKey, sizeof(config.weatherApiKey), type, value);
+		else if (type == JsonType::Number)
+		{
+			int number = atoi(value);
+
+			if (scanner.matches("brightness"))
+			{
+				if (number < 0) number = 0;
+				if (number > 15) number = 15;
+				config.brightness = number;
+			}
+			else if (scanner.matches("nightStart") && number >= 0 && number < 24)
+			{
+				config.nightStartHour = number;
+			}
+			else if (scanner.matches("nightEnd") && number >= 0 && number < 24)
+			{
+				config.nightEndHour = number;
 			}
-			return ESP_FAIL;
 		}
-		buf[ret] = '\0';
+	}
 
-		cJSON* root = cJSON_Parse(buf);
-		if (root == NULL)
+	void onConfigContainerEnd(const JsonScanner& scanner, void* ctx)
+	{
+		// Seen even when empty, which resets to the default location
+		if (scanner.matches("weatherLocations"))
+		{
+			static_cast<ConfigUpdate*>(ctx)->locationsSeen = true;
+		}
+	}
+
+	void applyLocations(ConfigUpdate& update)
+	{
+		if (update.locationsSeen)
+		{
+			const char* locations[DisplayConfig::MAX_WEATHER_LOCATIONS];
+			for (int i = 0; i < update.locationCount; i++)
+			{
+				locations[i] = update.locations[i];
+			}
+			ConfigManager::setWeatherLocations(update.config, locations, update.locationCount);
+		}
+	}
+
+	// Handler to save configuration
+	esp_err_t configPostHandler(httpd_req_t* req)
+	{
+		ConfigUpdate update = {};
+		ConfigManager::getConfig(update.config);
+
+		JsonScanner scanner(onConfigValue, &update, onConfigContainerEnd);
+		if (scanJsonBody(req, scanner) != ESP_OK)
+			return ESP_FAIL;
+
+		applyLocations(update);
+
+		// Listeners (the display task) are notified by the save itself;
+		// the flash write happens later in the background
+		if (!ConfigManager::saveConfig(update.config))
 		{
 			httpd_resp_send_500(req);
 			return ESP_FAIL;
 		}
 
-		DisplayConfig config;
-		ConfigManager::loadConfig(config);
+		httpd_resp_send(req, "OK", 2);
+		return ESP_OK;
+	}
 
-		cJSON* item = cJSON_GetObjectItem(root, "showClock");
-		if (item) config.showClock = cJSON_IsTrue(item);
+	// Preset slot from the "id" query parameter, or -1
+	int getPresetId(httpd_req_t* req)
+	{
+		char query[32];
+		char value[8];
+		if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+		    httpd_query_key_value(query, "id", value, sizeof(value)) != ESP_OK)
+			return -1;
+
+		char* end;
+		long id = strtol(value, &end, 10);
+		return (end != value && *end == '\0' && id >= 0 && id < ConfigManager::MAX_PRESETS) ? id : -1;
+	}
 
-		item = cJSON_GetObjectItem(root, "showWeather");
-		if (item) config.showWeather = cJSON_IsTrue(item);
+	// Handler to list presets
+	esp_err_t presetsGetHandler(httpd_req_t* req)
+	{
+		ConfigManager::PresetInfo presets[ConfigManager::MAX_PRESETS];
+		ConfigManager::getPresets(presets);
 
-		item = cJSON_GetObjectItem(root, "showStarWars");
-		if (item) config.showStarWarsQuotes = cJSON_IsTrue(item);
+		httpd_resp_set_type(req, "application/json");
+		JsonWriter json(sendJsonChunk, req);
+		json.beginObject();
+		json.addInt("active", ConfigManager::getActivePreset());
+		json.beginArray("presets");
+		for (int i = 0; i < ConfigManager::MAX_PRESETS; i++)
+		{
+			if (!presets[i].used)
+				continue;
+
+			json.beginObject();
+			json.addInt("id", i);
+			json.addString("name", presets[i].name);
+			json.endObject();
+		}
+		json.endArray();
+		json.endObject();
 
-		item = cJSON_GetObjectItem(root, "showLOTR");
-		if (item) config.showLOTRQuotes = cJSON_IsTrue(item);
+		return finishJson(req, json);
+	}
 
-		item = cJSON_GetObjectItem(root, "displayFlipped");
-		if (item) config.displayFlipped = cJSON_IsTrue(item);
+	struct PresetUpdate
+	{
+		ConfigUpdate update;
+		char name[ConfigManager::PRESET_NAME_LEN];
+	};
 
-		item = cJSON_GetObjectItem(root, "brightness");
-		if (item && cJSON_IsNumber(item))
+	// Same fields as /api/config, plus the preset's name
+	void onPresetValue(const JsonScanner& scanner, JsonType type, const char* value, void* ctx)
+	{
+		PresetUpdate& preset = *static_cast<PresetUpdate*>(ctx);
+		if (scanner.depth() == 1 && scanner.matches("name"))
 		{
-			int brightness = item->valueint;
-			if (brightness < 0) brightness = 0;
-			if (brightness > 15) brightness = 15;
-			config.brightness = brightness;
+			copyString(preset.name, sizeof(preset.name), type, value);
+			return;
 		}
+		onConfigValue(scanner, type, value, &preset.update);
+	}
 
-		item = cJSON_GetObjectItem(root, "customText");
-		if (item && cJSON_IsString(item))
+	void onPresetContainerEnd(const JsonScanner& scanner, void* ctx)
+	{
+		onConfigContainerEnd(scanner, &static_cast<PresetUpdate*>(ctx)->update);
+	}
+
+	// Handler to create or edit the preset named by ?id=; fields not in the
+	// body keep the preset's values, and a new preset starts from the
+	// current config
+	esp_err_t presetPostHandler(httpd_req_t* req)
+	{
+		int id = getPresetId(req);
+		if (id < 0)
 		{
-			strncpy(config.customText, item->valuestring, sizeof(config.customText) - 1);
+			httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid preset id");
+			return ESP_FAIL;
 		}
 
-		item = cJSON_GetObjectItem(root, "weatherApiKey");
-		if (item && cJSON_IsString(item))
+		PresetUpdate preset = {};
+		if (ConfigManager::getPreset(id, preset.update.config))
 		{
-			strncpy(config.weatherApiKey, item->valuestring, sizeof(config.weatherApiKey) - 1);
-			config.weatherApiKey[sizeof(config.weatherApiKey) - 1] = '\0';
+			ConfigManager::PresetInfo presets[ConfigManager::MAX_PRESETS];
+			ConfigManager::getPresets(presets);
+			memcpy(preset.name, presets[id].name, sizeof(preset.name));
+		}
+		else
+		{
+			ConfigManager::getConfig(preset.update.config);
 		}
 
-		ConfigManager::saveConfig(config);
-		cJSON_Delete(root);
+		JsonScanner scanner(onPresetValue, &preset, onPresetContainerEnd);
+		if (scanJsonBody(req, scanner) != ESP_OK)
+			return ESP_FAIL;
+
+		applyLocations(preset.update);
+
+		if (!ConfigManager::savePreset(id, preset.name, preset.update.config))
+		{
+			httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Preset needs a name");
+			return ESP_FAIL;
+		}
 
 		httpd_resp_send(req, "OK", 2);
 		return ESP_OK;
 	}
 
+	void onPresetIdValue(const JsonScanner& scanner, JsonType type, const char* value, void* ctx)
+	{
+		if (scanner.depth() == 1 && scanner.matches("id") && type == JsonType::Number)
+		{
+			*static_cast<int*>(ctx) = atoi(value);
+		}
+	}
+
+	// Handler to switch the active preset
+	esp_err_t presetActivateHandler(httpd_req_t* req)
+	{
+		int id = -1;
+		JsonScanner scanner(onPresetIdValue, &id);
+		if (scanJsonBody(req, scanner) != ESP_OK)
+			return ESP_FAIL;
+
+		if (!ConfigManager::activatePreset(id))
+		{
+			httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown preset");
+			return ESP_FAIL;
+		}
+
+		httpd_resp_send(req, "OK", 2);
+		return ESP_OK;
+	}
+
+	// Handler to remove the preset named by ?id=
+	esp_err_t presetDeleteHandler(httpd_req_t* req)
+	{
+		int id = getPresetId(req);
+		if (id < 0 || !ConfigManager::deletePreset(id))
+		{
+			httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown or active preset");
+			return ESP_FAIL;
+		}
+
+		httpd_resp_send(req, "OK", 2);
+		return ESP_OK;
+	}
+
+	const uint32_t MESSAGE_DEFAULT_TTL_S = 300;
+	const uint32_t MESSAGE_MAX_TTL_S = 24 * 3600;
+	const int MESSAGE_MAX_REPEAT = 10;
+
+	struct MessageRequest
+	{
+		char text[Message::MAX_TEXT_LEN];
+		MessagePriority priority;
+		uint32_t ttlSeconds;
+		int repeat;
+	};
+
+	void onMessageValue(const JsonScanner& scanner, JsonType type, const char* value, void* ctx)
+	{
+		MessageRequest& request = *static_cast<MessageRequest*>(ctx);
+		if (scanner.depth() != 1)
+			return;
+
+		if (scanner.matches("text"))
+		{
+			copyString(request.text, sizeof(request.text), type, value);
+		}
+		else if (scanner.matches("priority") && type == JsonType::String)
+		{
+			request.priority = strcmp(value, "high") == 0 ? MessagePriority::High : MessagePriority::Normal;
+		}
+		else if (scanner.matches("ttl") && type == JsonType::Number)
+		{
+			long ttl = atol(value);
+			request.ttlSeconds = ttl < 1 ? 1 : (ttl > static_cast<long>(MESSAGE_MAX_TTL_S) ? MESSAGE_MAX_TTL_S : ttl);
+		}
+		else if (scanner.matches("repeat") && type == JsonType::Number)
+		{
+			int repeat = atoi(value);
+			request.repeat = repeat < 1 ? 1 : (repeat > MESSAGE_MAX_REPEAT ? MESSAGE_MAX_REPEAT : repeat);
+		}
+	}
+
+	// Handler to queue a one-off message; nothing is persisted
+	esp_err_t messagePostHandler(httpd_req_t* req)
+	{
+		MessageRequest request = {"", MessagePriority::Normal, MESSAGE_DEFAULT_TTL_S, 1};
+		JsonScanner scanner(onMessageValue, &request);
+		if (scanJsonBody(req, scanner) != ESP_OK)
+			return ESP_FAIL;
+
+		if (request.text[0] == '\0')
+		{
+			httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Message needs text");
+			return ESP_FAIL;
+		}
+
+		if (!MessageQueue::push(request.text, request.priority, request.ttlSeconds, request.repeat))
+		{
+			httpd_resp_set_status(req, "503 Service Unavailable");
+			httpd_resp_set_hdr(req, "Retry-After", "10");
+			httpd_resp_send(req, "Queue full", 10);
+			return ESP_OK;
+		}
+
+		httpd_resp_set_status(req, "202 Accepted");
+		httpd_resp_send(req, "Queued", 6);
+		return ESP_OK;
+	}
+
+	// One byte longer than WiFi allows, so overlong values are rejected rather than cut
+	struct WifiCredentials
+	{
+		char ssid[34];
+		char password[66];
+		bool haveSsid;
+		bool havePassword;
+	};
+
+	void onWifiValue(const JsonScanner& scanner, JsonType type, const char* value, void* ctx)
+	{
+		WifiCredentials& creds = *static_cast<WifiCredentials*>(ctx);
+		if (type != JsonType::String || scanner.depth() != 1)
+			return;
+
+		if (scanner.matches("ssid"))
+		{
+			copyString(creds.ssid, sizeof(creds.ssid), type, value);
+			creds.haveSsid = true;
+		}
+		else if (scanner.matches("password"))
+		{
+			copyString(creds.password, sizeof(creds.password), type, value);
+			creds.havePassword = true;
+		}
+	}
+
 	// Handler to save WiFi configuration
 	esp_err_t wifiConfigHandler(httpd_req_t* req)
 	{
-		char buf[256];
-		int ret = httpd_req_recv(req, buf, sizeof(buf) - 1);
-		if (ret <= 0)
+		WifiCredentials creds = {};
+		JsonScanner scanner(onWifiValue, &creds);
+		if (scanJsonBody(req, scanner) != ESP_OK)
+			return ESP_FAIL;
+
+		// Switch live; credentials are only persisted once the new network works
+		if (!creds.haveSsid || !creds.havePassword || !WifiManager::applyWiFiConfig(creds.ssid, creds.password))
 		{
-			if (ret == HTTPD_SOCK_ERR_TIMEOUT)
+			httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid WiFi credentials");
+			return ESP_FAIL;
+		}
+
+		httpd_resp_set_status(req, "202 Accepted");
+		httpd_resp_send(req, "Switching", 9);
+		return ESP_OK;
+	}
+
+	// Handler to report WiFi switchover progress
+	esp_err_t wifiStatusHandler(httpd_req_t* req)
+	{
+		static const char* const stateNames[] = {"idle", "connecting", "connected", "failed"};
+
+		WifiManager::SwitchStatus status;
+		WifiManager::getSwitchStatus(status);
+
+		char ip[16] = "";
+		WifiManager::getIPAddress(ip, sizeof(ip));
+
+		httpd_resp_set_type(req, "application/json");
+		JsonWriter json(sendJsonChunk, req);
+		json.beginObject();
+		json.addString("state", stateNames[static_cast<int>(status.state)]);
+		json.addString("ssid", status.ssid);
+		json.addBool("connected", WifiManager::isConnected());
+		json.addString("ip", ip);
+		json.addBool("apActive", WifiManager::isConfigAPActive());
+		json.endObject();
+
+		return finishJson(req, json);
+	}
+
+	const char* const powerProfileNames[] = {"none", "min", "max"};
+
+	struct PowerRequest
+	{
+		WifiManager::PowerProfile profile;
+		uint16_t listenInterval;
+	};
+
+	void onPowerValue(const JsonScanner& scanner, JsonType type, const char* value, void* ctx)
+	{
+		PowerRequest& request = *static_cast<PowerRequest*>(ctx);
+		if (scanner.depth() != 1)
+			return;
+
+		if (scanner.matches("profile") && type == JsonType::String)
+		{
+			for (int i = 0; i < static_cast<int>(WifiManager::PowerProfile::Count); i++)
 			{
-				httpd_resp_send_408(req);
+				if (strcmp(value, powerProfileNames[i]) == 0)
+				{
+					request.profile = static_cast<WifiManager::PowerProfile>(i);
+				}
 			}
-			return ESP_FAIL;
 		}
-		buf[ret] = '\0';
+		else if (scanner.matches("listenInterval") && type == JsonType::Number)
+		{
+			request.listenInterval = atoi(value);
+		}
+	}
+
+	// Handler to select the WiFi power-save profile
+	esp_err_t wifiPowerHandler(httpd_req_t* req)
+	{
+		PowerRequest request = {WifiManager::getPowerProfile(), WifiManager::getListenInterval()};
+		JsonScanner scanner(onPowerValue, &request);
+		if (scanJsonBody(req, scanner) != ESP_OK)
+			return ESP_FAIL;
 
-		cJSON* root = cJSON_Parse(buf);
-		if (root == NULL)
+		if (!WifiManager::setPowerProfile(request.profile, request.listenInterval))
 		{
-			httpd_resp_send_500(req);
+			httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid power profile");
 			return ESP_FAIL;
 		}
 
-		cJSON* ssidItem = cJSON_GetObjectItem(root, "ssid");
-		cJSON* passItem = cJSON_GetObjectItem(root, "password");
+		httpd_resp_send(req, "OK", 2);
+		return ESP_OK;
+	}
 
-		if (ssidItem && cJSON_IsString(ssidItem) && passItem && cJSON_IsString(passItem))
+	/**
+	 * Memory use per endpoint. Handlers run one at a time on the httpd
+	 * task, so this is only touched from there and needs no lock.
+	 */
+	struct Endpoint
+	{
+		const char* uri;
+		httpd_method_t method;
+		esp_err_t (*handler)(httpd_req_t* req);
+		uint32_t requests;
+		uint32_t peakHeap;   // Most heap in use at once during one request, in bytes
+	};
+
+	esp_err_t statsGetHandler(httpd_req_t* req);
+
+	Endpoint endpoints[] = {
+		{"/",                   HTTP_GET,    assetHandler,          0, 0},
+		{"/assets/*",           HTTP_GET,    assetHandler,          0, 0},
+		{"/api/config",         HTTP_GET,    configGetHandler,      0, 0},
+		{"/api/config",         HTTP_POST,   configPostHandler,     0, 0},
+		{"/api/presets",        HTTP_GET,    presetsGetHandler,     0, 0},
+		{"/api/presets",        HTTP_POST,   presetPostHandler,     0, 0},
+		{"/api/presets",        HTTP_DELETE, presetDeleteHandler,   0, 0},
+		{"/api/presets/active", HTTP_POST,   presetActivateHandler, 0, 0},
+		{"/api/messages",       HTTP_POST,   messagePostHandler,    0, 0},
+		{"/api/wifi",           HTTP_POST,   wifiConfigHandler,     0, 0},
+		{"/api/wifi",           HTTP_GET,    wifiStatusHandler,     0, 0},
+		{"/api/wifi/power",     HTTP_POST,   wifiPowerHandler,      0, 0},
+		{"/api/stats",          HTTP_GET,    statsGetHandler,       0, 0},
+	};
+
+	void addLatency(JsonWriter& json, const char* key, const WifiManager::LatencyStats& latency)
+	{
+		json.beginObject(key);
+		json.addInt("requests", latency.requests);
+		json.addInt("avgLatencyMs", latency.avgLatencyMs);
+		json.addInt("maxLatencyMs", latency.maxLatencyMs);
+		json.endObject();
+	}
+
+	// Registered for every endpoint; runs the real handler and records its footprint
+	esp_err_t meteredHandler(httpd_req_t* req)
+	{
+		Endpoint* endpoint = static_cast<Endpoint*>(req->user_ctx);
+
+		// The heap's minimum-free watermark is restarted for the call, so an
+		// allocation that is freed before returning still counts. httpd runs
+		// one handler at a time, but other tasks allocate concurrently, so
+		// this is an upper bound
+		size_t freeBefore = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+		bool monitoring = heap_caps_monitor_local_minimum_free_size_start() == ESP_OK;
+		int64_t startUs = esp_timer_get_time();
+		esp_err_t result = endpoint->handler(req);
+		int64_t elapsedUs = esp_timer_get_time() - startUs;
+		size_t freeMin = heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT);
+		if (monitoring)
 		{
-			WifiManager::saveWiFiConfig(ssidItem->valuestring, passItem->valuestring);
-			httpd_resp_send(req, "OK - Rebooting...", 18);
-			cJSON_Delete(root);
+			heap_caps_monitor_local_minimum_free_size_stop();
+		}
+		WifiManager::recordRequestLatency(WifiManager::RequestDirection::Inbound, static_cast<uint32_t>(elapsedUs / 1000));
 
-			// Reboot after 2 seconds
-			vTaskDelay(2000 / portTICK_PERIOD_MS);
-			esp_restart();
-			return ESP_OK;
+		endpoint->requests++;
+		uint32_t peak = (monitoring && freeBefore > freeMin) ? freeBefore - freeMin : 0;
+		if (peak > endpoint->peakHeap)
+		{
+			endpoint->peakHeap = peak;
 		}
+		return result;
+	}
+
+	// Handler to report runtime statistics
+	esp_err_t statsGetHandler(httpd_req_t* req)
+	{
+		WeatherFetchStats fetch;
+		WeatherFetcher::getFetchStats(fetch);
 
-		cJSON_Delete(root);
-		httpd_resp_send_500(req);
-		return ESP_FAIL;
+		httpd_resp_set_type(req, "application/json");
+		JsonWriter json(sendJsonChunk, req);
+		json.beginObject();
+
+		json.beginObject("display");
+		json.addInt("cpuDutyPermille", DisplayController::getDutyCyclePermille());
+		json.endObject();
+
+		MessageQueueStats messages;
+		MessageQueue::getStats(messages);
+		json.beginObject("messages");
+		json.addInt("queued", messages.queued);
+		json.addInt("rejected", messages.rejected);
+		json.addInt("expired", messages.expired);
+		json.addInt("shown", messages.shown);
+		json.endObject();
+
+		ConfigManager::PersistStats persist;
+		ConfigManager::getPersistStats(persist);
+		json.beginObject("configStore");
+		json.addInt("saves", persist.saves);
+		json.addInt("commits", persist.commits);
+		json.addInt("coalesced", persist.coalesced);
+		json.addInt("failures", persist.failures);
+		json.addInt("lastCommitUs", persist.lastCommitUs);
+		json.addBool("pending", persist.pending);
+		json.endObject();
+
+		json.beginObject("weatherFetch");
+		json.addInt("fetches", fetch.fetches);
+		json.addInt("failures", fetch.failures);
+		json.addInt("notModified", fetch.notModified);
+		json.addInt("newConnections", fetch.newConnections);
+		json.addInt("reusedConnections", fetch.reusedConnections);
+		json.addInt("lastDnsMs", fetch.lastDnsMs);
+		json.addInt("lastConnectMs", fetch.lastConnectMs);
+		json.addInt("lastTtfbMs", fetch.lastTtfbMs);
+		json.addInt("lastBodyMs", fetch.lastBodyMs);
+		json.addInt("lastTotalMs", fetch.lastTotalMs);
+		json.addInt("avgConnectMs", fetch.avgConnectMs);
+		json.addInt("avgTtfbMs", fetch.avgTtfbMs);
+		json.addInt("avgBodyMs", fetch.avgBodyMs);
+		json.endObject();
+
+		json.beginObject("wifiPower");
+		json.addString("profile", powerProfileNames[static_cast<int>(WifiManager::getPowerProfile())]);
+		json.addInt("listenInterval", WifiManager::getListenInterval());
+
+		json.beginArray("profiles");
+		for (int i = 0; i < static_cast<int>(WifiManager::PowerProfile::Count); i++)
+		{
+			WifiManager::PowerStats stats;
+			WifiManager::getPowerStats(static_cast<WifiManager::PowerProfile>(i), stats);
+
+			json.beginObject();
+			json.addString("name", powerProfileNames[i]);
+			addLatency(json, "outbound", stats.outbound);
+			addLatency(json, "inbound", stats.inbound);
+			json.addInt("activeSeconds", stats.activeSeconds);
+			json.addInt("wakeIntervalMs", stats.wakeIntervalMs);
+			json.addInt("estimatedWakes", stats.estimatedWakes);
+			json.addInt("beaconTimeouts", stats.beaconTimeouts);
+			json.endObject();
+		}
+		json.endArray();
+		json.endObject();
+
+		json.beginObject("webServer");
+		json.addInt("freeHeap", esp_get_free_heap_size());
+		json.addInt("minFreeHeap", esp_get_minimum_free_heap_size());
+		// Lowest stack headroom of the httpd task since boot, in bytes; this
+		// handler runs on that task like every other endpoint
+		json.addInt("httpdStackFree", uxTaskGetStackHighWaterMark(nullptr));
+
+		json.beginArray("endpoints");
+		for (const Endpoint& endpoint : endpoints)
+		{
+			json.beginObject();
+			json.addString("method", endpoint.method == HTTP_POST ? "POST" :
+			                         endpoint.method == HTTP_DELETE ? "DELETE" : "GET");
+			json.addString("uri", endpoint.uri);
+			json.addInt("requests", endpoint.requests);
+			json.addInt("peakHeap", endpoint.peakHeap);
+			json.endObject();
+		}
+		json.endArray();
+		json.endObject();
+
+		json.endObject();
+		return finishJson(req, json);
 	}
 }
 
 void WebServer::start()
 {
+	configEtagSeed = esp_random();
+
 	httpd_config_t config = HTTPD_DEFAULT_CONFIG();
 	config.uri_match_fn = httpd_uri_match_wildcard;
+	config.max_uri_handlers = sizeof(endpoints) / sizeof(endpoints[0]);
 
 	if (httpd_start(&server, &config) == ESP_OK)
 	{
-		httpd_uri_t rootUri = {
-			.uri      = "/",
-			.method   = HTTP_GET,
-			.handler  = rootHandler,
-			.user_ctx = nullptr,
-		};
-
-		httpd_uri_t configGetUri = {
-			.uri      = "/api/config",
-			.method   = HTTP_GET,
-			.handler  = configGetHandler,
-			.user_ctx = nullptr,
-		};
-
-		httpd_uri_t configPostUri = {
-			.uri      = "/api/config",
-			.method   = HTTP_POST,
-			.handler  = configPostHandler,
-			.user_ctx = nullptr,
-		};
-
-		httpd_uri_t wifiConfigUri = {
-			.uri      = "/api/wifi",
-			.method   = HTTP_POST,
-			.handler  = wifiConfigHandler,
-			.user_ctx = nullptr,
-		};
-
-		httpd_register_uri_handler(server, &rootUri);
-		httpd_register_uri_handler(server, &configGetUri);
-		httpd_register_uri_handler(server, &configPostUri);
-		httpd_register_uri_handler(server, &wifiConfigUri);
+		for (Endpoint& endpoint : endpoints)
+		{
+			httpd_uri_t uri = {
+				.uri      = endpoint.uri,
+				.method   = endpoint.method,
+				.handler  = meteredHandler,
+				.user_ctx = &endpoint,
+			};
+			httpd_register_uri_handler(server, &uri);
+		}
 
 		ESP_LOGI(TAG, "Web server started");
 	}
@@ -1,17 +1,26 @@
 #include "WifiManager.hpp"
 
+#include <atomic>
 #include <cstring>
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
 #include "esp_mac.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
 #include "nvs_flash.h"
 #include "nvs.h"
 #include "esp_system.h"
 #include "esp_netif.h"
 
+extern "C" void wifi_event_handler(void* arg, esp_event_base_t event_base,
+                                   int32_t event_id, void* event_data);
+
 namespace
 {
 	const char *TAG = "WifiManager";
@@ -25,8 +34,588 @@ namespace
 	#define WIFI_FAIL_BIT      BIT1
 
 	EventGroupHandle_t wifiEventGroup;
-	int retryNum = 0;
 	const int MAX_RETRY = 5;
+
+	const uint32_t RECONNECT_BASE_MS = CONFIG_ESP_WIFI_RECONNECT_BASE_MS;
+	const uint32_t RECONNECT_MAX_MS = CONFIG_ESP_WIFI_RECONNECT_MAX_MS;
+
+	const int MAX_CONNECTIVITY_LISTENERS = 4;
+
+	struct ConnectivityListener
+	{
+		WifiManager::ConnectivityCallback callback;
+		void* ctx;
+	};
+
+	ConnectivityListener listeners[MAX_CONNECTIVITY_LISTENERS] = {};
+	int listenerCount = 0;
+
+	// Messages posted to the supervisor task
+	enum class SupervisorEvent : uint8_t
+	{
+		Disconnected,
+		Connected,
+		ApplyCredentials,
+	};
+
+	struct SupervisorMsg
+	{
+		SupervisorEvent event;
+		uint8_t reason;
+		char ssid[33];
+		char password[65];
+	};
+
+	QueueHandle_t supervisorQueue = nullptr;
+	TaskHandle_t supervisorTask = nullptr;
+
+	esp_netif_t* staNetif = nullptr;
+	esp_netif_t* apNetif = nullptr;
+	bool wifiDriverReady = false;
+	std::atomic<bool> configAPActive{false};
+	std::atomic<uint32_t> staIpAddr{0};
+
+	// How long a credential switchover may take before reverting
+	const uint32_t SWITCH_TIMEOUT_MS = 30 * 1000;
+	// Delay between association attempts during a switchover
+	const uint32_t SWITCH_RETRY_MS = 2000;
+	// Let the HTTP response that requested a switchover reach the client
+	const uint32_t SWITCH_START_DELAY_MS = 500;
+	// Keep the config AP up after STA connects so a portal client can
+	// still read the outcome (and the new IP) before it disappears
+	const uint32_t AP_LINGER_MS = 60 * 1000;
+
+	// Power-save profile state and per-profile statistics
+	const uint16_t DEFAULT_LISTEN_INTERVAL = 3;
+	const uint16_t MAX_LISTEN_INTERVAL = 10;
+	const uint32_t BEACON_INTERVAL_MS = 102;  // 100 TU, the near-universal AP default
+
+	struct LatencyAccumulator
+	{
+		uint32_t requests;
+		uint64_t latencySumMs;
+		uint32_t maxLatencyMs;
+	};
+
+	struct ProfileAccumulator
+	{
+		LatencyAccumulator latency[static_cast<int>(WifiManager::RequestDirection::Count)];
+		int64_t activeUs;
+		uint32_t beaconTimeouts;
+	};
+
+	SemaphoreHandle_t powerMutex = nullptr;
+	ProfileAccumulator profileStats[static_cast<int>(WifiManager::PowerProfile::Count)] = {};
+	WifiManager::PowerProfile powerProfile = WifiManager::PowerProfile::MinModem;
+	uint16_t listenInterval = DEFAULT_LISTEN_INTERVAL;
+	int64_t profileSinceUs = 0;
+
+	wifi_ps_type_t toPsType(WifiManager::PowerProfile profile)
+	{
+		switch (profile)
+		{
+		case WifiManager::PowerProfile::None:
+			return WIFI_PS_NONE;
+		case WifiManager::PowerProfile::MaxModem:
+			return WIFI_PS_MAX_MODEM;
+		default:
+			return WIFI_PS_MIN_MODEM;
+		}
+	}
+
+	// DTIM is not reported by the driver, so MinModem assumes DTIM 1
+	uint32_t wakeIntervalMs(WifiManager::PowerProfile profile, uint16_t interval)
+	{
+		switch (profile)
+		{
+		case WifiManager::PowerProfile::None:
+			return 0;
+		case WifiManager::PowerProfile::MaxModem:
+			return BEACON_INTERVAL_MS * interval;
+		default:
+			return BEACON_INTERVAL_MS;
+		}
+	}
+
+	void loadPowerSettings()
+	{
+		nvs_handle_t nvsHandle;
+		if (nvs_open("storage", NVS_READONLY, &nvsHandle) != ESP_OK)
+			return;
+
+		uint8_t profile;
+		if (nvs_get_u8(nvsHandle, "wifi_ps", &profile) == ESP_OK &&
+		    profile < static_cast<uint8_t>(WifiManager::PowerProfile::Count))
+		{
+			powerProfile = static_cast<WifiManager::PowerProfile>(profile);
+		}
+
+		uint16_t interval;
+		if (nvs_get_u16(nvsHandle, "wifi_li", &interval) == ESP_OK &&
+		    interval >= 1 && interval <= MAX_LISTEN_INTERVAL)
+		{
+			listenInterval = interval;
+		}
+
+		nvs_close(nvsHandle);
+	}
+
+	bool savePowerSettings()
+	{
+		nvs_handle_t nvsHandle;
+		esp_err_t err = nvs_open("storage", NVS_READWRITE, &nvsHandle);
+		if (err != ESP_OK)
+		{
+			ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
+			return false;
+		}
+
+		err = nvs_set_u8(nvsHandle, "wifi_ps", static_cast<uint8_t>(powerProfile));
+		if (err == ESP_OK)
+			err = nvs_set_u16(nvsHandle, "wifi_li", listenInterval);
+		if (err == ESP_OK)
+			err = nvs_commit(nvsHandle);
+
+		nvs_close(nvsHandle);
+		if (err != ESP_OK)
+		{
+			ESP_LOGE(TAG, "Error saving power profile: %s", esp_err_to_name(err));
+			return false;
+		}
+		return true;
+	}
+
+	SemaphoreHandle_t switchStatusMutex = nullptr;
+	WifiManager::SwitchStatus switchStatus = {};
+
+	void setSwitchStatus(WifiManager::SwitchState state, const char* ssid)
+	{
+		xSemaphoreTake(switchStatusMutex, portMAX_DELAY);
+		switchStatus.state = state;
+		if (ssid != nullptr)
+		{
+			strncpy(switchStatus.ssid, ssid, sizeof(switchStatus.ssid) - 1);
+			switchStatus.ssid[sizeof(switchStatus.ssid) - 1] = '\0';
+		}
+		xSemaphoreGive(switchStatusMutex);
+	}
+
+	void publishConnectivity(bool connected)
+	{
+		for (int i = 0; i < listenerCount; i++)
+		{
+			listeners[i].callback(connected, listeners[i].ctx);
+		}
+	}
+
+	void buildAPConfig(wifi_config_t& wifi_config)
+	{
+		wifi_config = {};
+		strncpy(reinterpret_cast<char*>(wifi_config.ap.ssid), EXAMPLE_ESP_WIFI_SSID, sizeof(wifi_config.ap.ssid));
+		wifi_config.ap.ssid_len = strlen(EXAMPLE_ESP_WIFI_SSID);
+		wifi_config.ap.channel = EXAMPLE_ESP_WIFI_CHANNEL;
+		strncpy(reinterpret_cast<char*>(wifi_config.ap.password), EXAMPLE_ESP_WIFI_PASS, sizeof(wifi_config.ap.password));
+		wifi_config.ap.max_connection = EXAMPLE_MAX_STA_CONN;
+
+#ifdef CONFIG_ESP_WIFI_SOFTAP_SAE_SUPPORT
+		wifi_config.ap.authmode = WIFI_AUTH_WPA3_PSK;
+		wifi_config.ap.sae_pwe_h2e = WPA3_SAE_PWE_BOTH;
+#else
+		wifi_config.ap.authmode = WIFI_AUTH_WPA2_PSK;
+#endif
+
+		wifi_config.ap.pmf_cfg.required = true;
+
+		if (strlen(EXAMPLE_ESP_WIFI_PASS) == 0)
+		{
+			wifi_config.ap.authmode = WIFI_AUTH_OPEN;
+		}
+	}
+
+	/**
+	 * Backoff for the given attempt number (1-based): the base delay doubled
+	 * per attempt and capped at RECONNECT_MAX_MS, with "equal jitter" so a
+	 * room full of clocks does not hammer the router in lock-step after it
+	 * reboots.
+	 */
+	uint32_t reconnectDelayMs(int attempt)
+	{
+		uint32_t delay = RECONNECT_BASE_MS;
+		for (int i = 1; i < attempt && delay < RECONNECT_MAX_MS; i++)
+		{
+			delay *= 2;
+		}
+		if (delay > RECONNECT_MAX_MS)
+		{
+			delay = RECONNECT_MAX_MS;
+		}
+
+		uint32_t half = delay / 2;
+		return half + (half > 0 ? esp_random() % (half + 1) : 0);
+	}
+
+	/**
+	 * Run the config AP alongside STA (AP+STA) or drop back to STA only.
+	 * Used both for the reconnect fallback and to keep the portal reachable
+	 * during a credential switchover.
+	 */
+	void setConfigAP(bool enable)
+	{
+		if (enable == configAPActive.load())
+			return;
+
+		if (enable)
+		{
+			wifi_config_t apConfig;
+			buildAPConfig(apConfig);
+			esp_err_t err = esp_wifi_set_mode(WIFI_MODE_APSTA);
+			if (err == ESP_OK)
+			{
+				err = esp_wifi_set_config(WIFI_IF_AP, &apConfig);
+			}
+			if (err != ESP_OK)
+			{
+				ESP_LOGE(TAG, "Failed to enable config AP: %s", esp_err_to_name(err));
+				return;
+			}
+			ESP_LOGI(TAG, "Config AP enabled alongside STA (SSID:%s)", EXAMPLE_ESP_WIFI_SSID);
+		}
+		else
+		{
+			esp_err_t err = esp_wifi_set_mode(WIFI_MODE_STA);
+			if (err != ESP_OK)
+			{
+				ESP_LOGE(TAG, "Failed to disable config AP: %s", esp_err_to_name(err));
+				return;
+			}
+			ESP_LOGI(TAG, "Config AP disabled");
+		}
+		configAPActive = enable;
+	}
+
+	bool setStaCredentials(const char* ssid, const char* password)
+	{
+		wifi_config_t staConfig = {};
+		strncpy(reinterpret_cast<char*>(staConfig.sta.ssid), ssid, sizeof(staConfig.sta.ssid));
+		strncpy(reinterpret_cast<char*>(staConfig.sta.password), password, sizeof(staConfig.sta.password));
+		staConfig.sta.listen_interval = listenInterval;
+
+		esp_err_t err = esp_wifi_set_config(WIFI_IF_STA, &staConfig);
+		if (err != ESP_OK)
+		{
+			ESP_LOGE(TAG, "Failed to set STA config: %s", esp_err_to_name(err));
+			return false;
+		}
+		return true;
+	}
+
+	TickType_t ticksUntil(TickType_t deadline)
+	{
+		TickType_t now = xTaskGetTickCount();
+		return (static_cast<int32_t>(deadline - now) > 0) ? (deadline - now) : 0;
+	}
+
+	/**
+	 * Supervisor state. Only touched from the supervisor task.
+	 */
+	struct Supervisor
+	{
+		int attempt = 0;
+		// Set on the first successful connection since boot
+		bool everConnected = false;
+
+		bool retryPending = false;
+		TickType_t retryAt = 0;
+
+		bool apOffPending = false;
+		TickType_t apOffAt = 0;
+
+		// Credential switchover in progress
+		bool switching = false;
+		bool switchStarted = false;
+		TickType_t switchStartAt = 0;
+		TickType_t switchDeadline = 0;
+		wifi_config_t previousConfig = {};
+		bool hadPrevious = false;
+		bool apOnlyBefore = false;
+		char pendingSsid[33] = {};
+		char pendingPassword[65] = {};
+
+		TickType_t nextWait() const
+		{
+			TickType_t wait = portMAX_DELAY;
+			if (retryPending && ticksUntil(retryAt) < wait)
+				wait = ticksUntil(retryAt);
+			if (apOffPending && ticksUntil(apOffAt) < wait)
+				wait = ticksUntil(apOffAt);
+			if (switching && !switchStarted && ticksUntil(switchStartAt) < wait)
+				wait = ticksUntil(switchStartAt);
+			if (switching && switchStarted && ticksUntil(switchDeadline) < wait)
+				wait = ticksUntil(switchDeadline);
+			return wait;
+		}
+
+		void scheduleRetry(uint32_t delayMs)
+		{
+			retryAt = xTaskGetTickCount() + pdMS_TO_TICKS(delayMs);
+			retryPending = true;
+		}
+
+		void onDisconnected(uint8_t reason)
+		{
+			if (switching)
+			{
+				// Keep hammering the new network until the switch deadline
+				if (switchStarted)
+				{
+					scheduleRetry(SWITCH_RETRY_MS);
+				}
+				return;
+			}
+
+			attempt++;
+			uint32_t delayMs = reconnectDelayMs(attempt);
+			scheduleRetry(delayMs);
+			ESP_LOGI(TAG, "STA disconnected (reason %d), retry %d in %lu ms",
+			         reason, attempt, static_cast<unsigned long>(delayMs));
+
+			if (attempt == MAX_RETRY)
+			{
+				xEventGroupSetBits(wifiEventGroup, WIFI_FAIL_BIT);
+				// Without a connection since boot the stored credentials may be
+				// wrong, and the AP is the only way left to fix them
+#if CONFIG_ESP_WIFI_FALLBACK_AP
+				bool startAP = true;
+#else
+				bool startAP = !everConnected;
+#endif
+				if (startAP)
+				{
+					setConfigAP(true);
+					apOffPending = false;
+				}
+			}
+		}
+
+		void onConnected()
+		{
+			attempt = 0;
+			everConnected = true;
+			retryPending = false;
+
+			if (switching && switchStarted)
+			{
+				// Only now is the new network proven good enough to persist
+				switching = false;
+				if (WifiManager::saveWiFiConfig(pendingSsid, pendingPassword))
+				{
+					ESP_LOGI(TAG, "Switched to SSID:%s", pendingSsid);
+					setSwitchStatus(WifiManager::SwitchState::Succeeded, nullptr);
+				}
+				else
+				{
+					setSwitchStatus(WifiManager::SwitchState::Failed, nullptr);
+				}
+				memset(pendingPassword, 0, sizeof(pendingPassword));
+			}
+
+			if (configAPActive)
+			{
+				apOffAt = xTaskGetTickCount() + pdMS_TO_TICKS(AP_LINGER_MS);
+				apOffPending = true;
+			}
+		}
+
+		void onApplyCredentials(const SupervisorMsg& msg)
+		{
+			strncpy(pendingSsid, msg.ssid, sizeof(pendingSsid) - 1);
+			pendingSsid[sizeof(pendingSsid) - 1] = '\0';
+			strncpy(pendingPassword, msg.password, sizeof(pendingPassword) - 1);
+			pendingPassword[sizeof(pendingPassword) - 1] = '\0';
+
+			switching = true;
+			switchStarted = false;
+			switchStartAt = xTaskGetTickCount() + pdMS_TO_TICKS(SWITCH_START_DELAY_MS);
+			setSwitchStatus(WifiManager::SwitchState::InProgress, pendingSsid);
+		}
+
+		void beginSwitch()
+		{
+			switchStarted = true;
+			switchDeadline = xTaskGetTickCount() + pdMS_TO_TICKS(SWITCH_TIMEOUT_MS);
+			retryPending = false;
+			apOffPending = false;
+
+			wifi_mode_t mode = WIFI_MODE_NULL;
+			esp_wifi_get_mode(&mode);
+			apOnlyBefore = (mode == WIFI_MODE_AP);
+
+			hadPrevious = false;
+			if (!apOnlyBefore && esp_wifi_get_config(WIFI_IF_STA, &previousConfig) == ESP_OK)
+			{
+				hadPrevious = previousConfig.sta.ssid[0] != '\0';
+			}
+
+			// Keep the portal reachable while the STA interface is retargeted
+			if (apOnlyBefore)
+			{
+				esp_wifi_set_mode(WIFI_MODE_APSTA);
+			}
+			else
+			{
+				setConfigAP(true);
+			}
+
+			ESP_LOGI(TAG, "Trying SSID:%s", pendingSsid);
+			esp_wifi_disconnect();
+			if (!setStaCredentials(pendingSsid, pendingPassword))
+			{
+				abortSwitch();
+				return;
+			}
+			esp_wifi_connect();
+		}
+
+		void abortSwitch()
+		{
+			ESP_LOGW(TAG, "Could not join SSID:%s, reverting", pendingSsid);
+			switching = false;
+			memset(pendingPassword, 0, sizeof(pendingPassword));
+			setSwitchStatus(WifiManager::SwitchState::Failed, nullptr);
+
+			esp_wifi_disconnect();
+			if (hadPrevious)
+			{
+				esp_wifi_set_config(WIFI_IF_STA, &previousConfig);
+				attempt = 0;
+				scheduleRetry(0);
+			}
+			else if (apOnlyBefore)
+			{
+				esp_wifi_set_mode(WIFI_MODE_AP);
+			}
+		}
+
+		void onTimeout()
+		{
+			if (switching && !switchStarted && ticksUntil(switchStartAt) == 0)
+			{
+				beginSwitch();
+				return;
+			}
+
+			if (switching && switchStarted && ticksUntil(switchDeadline) == 0)
+			{
+				abortSwitch();
+			}
+
+			if (apOffPending && ticksUntil(apOffAt) == 0)
+			{
+				apOffPending = false;
+				if (WifiManager::isConnected())
+				{
+					setConfigAP(false);
+				}
+			}
+
+			if (retryPending && ticksUntil(retryAt) == 0)
+			{
+				retryPending = false;
+				esp_err_t err = esp_wifi_connect();
+				if (err != ESP_OK)
+				{
+					ESP_LOGW(TAG, "esp_wifi_connect failed: %s", esp_err_to_name(err));
+				}
+			}
+		}
+	};
+
+	/**
+	 * Owns all reconnection and switchover decisions so the event handler
+	 * and HTTP handlers never block and the display task is never involved.
+	 * Sleeps on the queue until either a message arrives or the nearest
+	 * pending deadline expires.
+	 */
+	void supervisorTaskMain(void*)
+	{
+		static Supervisor sup;
+
+		for (;;)
+		{
+			SupervisorMsg msg;
+			if (xQueueReceive(supervisorQueue, &msg, sup.nextWait()) == pdTRUE)
+			{
+				switch (msg.event)
+				{
+				case SupervisorEvent::Disconnected:
+					sup.onDisconnected(msg.reason);
+					break;
+				case SupervisorEvent::Connected:
+					sup.onConnected();
+					break;
+				case SupervisorEvent::ApplyCredentials:
+					sup.onApplyCredentials(msg);
+					break;
+				}
+			}
+			else
+			{
+				sup.onTimeout();
+			}
+		}
+	}
+
+	void postSupervisorEvent(SupervisorEvent event, uint8_t reason)
+	{
+		if (supervisorQueue == nullptr)
+			return;
+
+		SupervisorMsg msg = {};
+		msg.event = event;
+		msg.reason = reason;
+		if (xQueueSend(supervisorQueue, &msg, 0) != pdTRUE)
+		{
+			ESP_LOGW(TAG, "Supervisor queue full, dropping event");
+		}
+	}
+
+	// Create both netifs and initialise the driver exactly once, so the
+	// AP and STA paths can be combined at runtime (AP+STA fallback).
+	void ensureWifiDriver()
+	{
+		if (wifiDriverReady)
+			return;
+
+		staNetif = esp_netif_create_default_wifi_sta();
+		apNetif = esp_netif_create_default_wifi_ap();
+
+		wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+		ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+
+		loadPowerSettings();
+		profileSinceUs = esp_timer_get_time();
+
+		ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT,
+		                                                     ESP_EVENT_ANY_ID,
+		                                                     &wifi_event_handler,
+		                                                     nullptr,
+		                                                     nullptr));
+		ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT,
+		                                                     IP_EVENT_STA_GOT_IP,
+		                                                     &wifi_event_handler,
+		                                                     nullptr,
+		                                                     nullptr));
+		wifiDriverReady = true;
+	}
+
+	void startSupervisor()
+	{
+		if (supervisorTask != nullptr)
+			return;
+
+		supervisorQueue = xQueueCreate(8, sizeof(SupervisorMsg));
+		xTaskCreate(supervisorTaskMain, "wifi_sup", 3072, nullptr, 5, &supervisorTask);
+	}
 }
 
 extern "C" void wifi_event_handler(void* arg, esp_event_base_t event_base,
@@ -48,24 +637,30 @@ extern "C" void wifi_event_handler(void* arg, esp_event_base_t event_base,
 	}
 	else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED)
 	{
-		if (retryNum < MAX_RETRY)
-		{
-			esp_wifi_connect();
-			retryNum++;
-			ESP_LOGI(TAG, "retry to connect to the AP");
-		}
-		else
+		auto* event = static_cast<wifi_event_sta_disconnected_t*>(event_data);
+		EventBits_t bits = xEventGroupClearBits(wifiEventGroup, WIFI_CONNECTED_BIT);
+		if (bits & WIFI_CONNECTED_BIT)
 		{
-			xEventGroupSetBits(wifiEventGroup, WIFI_FAIL_BIT);
+			ESP_LOGW(TAG, "lost connection to the AP");
+			publishConnectivity(false);
 		}
-		ESP_LOGI(TAG, "connect to the AP fail");
+		postSupervisorEvent(SupervisorEvent::Disconnected, event->reason);
+	}
+	else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_BEACON_TIMEOUT)
+	{
+		xSemaphoreTake(powerMutex, portMAX_DELAY);
+		profileStats[static_cast<int>(powerProfile)].beaconTimeouts++;
+		xSemaphoreGive(powerMutex);
 	}
 	else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP)
 	{
 		auto* event = static_cast<ip_event_got_ip_t*>(event_data);
 		ESP_LOGI(TAG, "got ip:" IPSTR, IP2STR(&event->ip_info.ip));
-		retryNum = 0;
+		staIpAddr = event->ip_info.ip.addr;
+		xEventGroupClearBits(wifiEventGroup, WIFI_FAIL_BIT);
 		xEventGroupSetBits(wifiEventGroup, WIFI_CONNECTED_BIT);
+		postSupervisorEvent(SupervisorEvent::Connected, 0);
+		publishConnectivity(true);
 	}
 }
 
@@ -84,45 +679,21 @@ void WifiManager::init()
 	ESP_ERROR_CHECK(esp_event_loop_create_default());
 
 	wifiEventGroup = xEventGroupCreate();
+	switchStatusMutex = xSemaphoreCreateMutex();
+	powerMutex = xSemaphoreCreateMutex();
 }
 
 void WifiManager::startConfigAP()
 {
-	esp_netif_create_default_wifi_ap();
-
-	wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-	ESP_ERROR_CHECK(esp_wifi_init(&cfg));
-
-	ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT,
-	                                                     ESP_EVENT_ANY_ID,
-	                                                     &wifi_event_handler,
-	                                                     nullptr,
-	                                                     nullptr));
-
-	wifi_config_t wifi_config{};
-	strncpy(reinterpret_cast<char*>(wifi_config.ap.ssid), EXAMPLE_ESP_WIFI_SSID, sizeof(wifi_config.ap.ssid));
-	wifi_config.ap.ssid_len = strlen(EXAMPLE_ESP_WIFI_SSID);
-	wifi_config.ap.channel = EXAMPLE_ESP_WIFI_CHANNEL;
-	strncpy(reinterpret_cast<char*>(wifi_config.ap.password), EXAMPLE_ESP_WIFI_PASS, sizeof(wifi_config.ap.password));
-	wifi_config.ap.max_connection = EXAMPLE_MAX_STA_CONN;
-
-#ifdef CONFIG_ESP_WIFI_SOFTAP_SAE_SUPPORT
-	wifi_config.ap.authmode = WIFI_AUTH_WPA3_PSK;
-	wifi_config.ap.sae_pwe_h2e = WPA3_SAE_PWE_BOTH;
-#else
-	wifi_config.ap.authmode = WIFI_AUTH_WPA2_PSK;
-#endif
+	ensureWifiDriver();
 
-	wifi_config.ap.pmf_cfg.required = true;
-
-	if (strlen(EXAMPLE_ESP_WIFI_PASS) == 0)
-	{
-		wifi_config.ap.authmode = WIFI_AUTH_OPEN;
-	}
+	wifi_config_t wifi_config;
+	buildAPConfig(wifi_config);
 
 	ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_AP));
 	ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, &wifi_config));
 	ESP_ERROR_CHECK(esp_wifi_start());
+	configAPActive = true;
 
 	ESP_LOGI(TAG, "SoftAP started. SSID:%s password:%s channel:%d",
 	         EXAMPLE_ESP_WIFI_SSID, EXAMPLE_ESP_WIFI_PASS, EXAMPLE_ESP_WIFI_CHANNEL);
@@ -130,34 +701,18 @@ void WifiManager::startConfigAP()
 
 void WifiManager::connectToConfiguredWiFi()
 {
-	char ssid[32] = {0};
-	char password[64] = {0};
-
-	getConfiguredWiFi(ssid, password, sizeof(ssid));
-
-	esp_netif_create_default_wifi_sta();
+	char ssid[33] = {0};
+	char password[65] = {0};
 
-	wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-	ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+	getConfiguredWiFi(ssid, sizeof(ssid), password, sizeof(password));
 
-	ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT,
-	                                                     ESP_EVENT_ANY_ID,
-	                                                     &wifi_event_handler,
-	                                                     nullptr,
-	                                                     nullptr));
-	ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT,
-	                                                     IP_EVENT_STA_GOT_IP,
-	                                                     &wifi_event_handler,
-	                                                     nullptr,
-	                                                     nullptr));
-
-	wifi_config_t wifi_config = {};
-	strncpy((char *)wifi_config.sta.ssid, ssid, sizeof(wifi_config.sta.ssid));
-	strncpy((char *)wifi_config.sta.password, password, sizeof(wifi_config.sta.password));
+	ensureWifiDriver();
+	startSupervisor();
 
 	ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-	ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
+	setStaCredentials(ssid, password);
 	ESP_ERROR_CHECK(esp_wifi_start());
+	esp_wifi_set_ps(toPsType(powerProfile));
 
 	ESP_LOGI(TAG, "Connecting to SSID:%s...", ssid);
 }
@@ -221,7 +776,7 @@ bool WifiManager::hasConfiguredWiFi()
 	return (err == ESP_OK && required_size > 0);
 }
 
-void WifiManager::getConfiguredWiFi(char* ssid, char* password, size_t max_len)
+void WifiManager::getConfiguredWiFi(char* ssid, size_t ssidSize, char* password, size_t passwordSize)
 {
 	nvs_handle_t nvs_handle;
 	esp_err_t err;
@@ -233,14 +788,14 @@ void WifiManager::getConfiguredWiFi(char* ssid, char* password, size_t max_len)
 		return;
 	}
 
-	size_t ssid_len = max_len;
+	size_t ssid_len = ssidSize;
 	err = nvs_get_str(nvs_handle, "wifi_ssid", ssid, &ssid_len);
 	if (err != ESP_OK)
 	{
 		ESP_LOGE(TAG, "Error reading SSID: %s", esp_err_to_name(err));
 	}
 
-	size_t pass_len = max_len * 2;
+	size_t pass_len = passwordSize;
 	err = nvs_get_str(nvs_handle, "wifi_pass", password, &pass_len);
 	if (err != ESP_OK)
 	{
@@ -283,3 +838,164 @@ void WifiManager::waitForConnection()
 		ESP_LOGE(TAG, "UNEXPECTED EVENT");
 	}
 }
+
+bool WifiManager::isConfigAPActive()
+{
+	return configAPActive.load();
+}
+
+bool WifiManager::addConnectivityListener(ConnectivityCallback callback, void* ctx)
+{
+	if (callback == nullptr || listenerCount >= MAX_CONNECTIVITY_LISTENERS)
+	{
+		ESP_LOGE(TAG, "Cannot register connectivity listener");
+		return false;
+	}
+
+	listeners[listenerCount].callback = callback;
+	listeners[listenerCount].ctx = ctx;
+	listenerCount++;
+	return true;
+}
+
+bool WifiManager::applyWiFiConfig(const char* ssid, const char* password)
+{
+	if (ssid == nullptr || password == nullptr)
+		return false;
+
+	size_t ssidLen = strlen(ssid);
+	if (ssidLen == 0 || ssidLen > 32 || strlen(password) > 64)
+	{
+		ESP_LOGW(TAG, "Rejecting invalid WiFi credentials");
+		return false;
+	}
+
+	ensureWifiDriver();
+	startSupervisor();
+
+	SupervisorMsg msg = {};
+	msg.event = SupervisorEvent::ApplyCredentials;
+	strncpy(msg.ssid, ssid, sizeof(msg.ssid) - 1);
+	strncpy(msg.password, password, sizeof(msg.password) - 1);
+
+	bool queued = xQueueSend(supervisorQueue, &msg, pdMS_TO_TICKS(100)) == pdTRUE;
+	memset(msg.password, 0, sizeof(msg.password));
+	return queued;
+}
+
+void WifiManager::getSwitchStatus(SwitchStatus& status)
+{
+	xSemaphoreTake(switchStatusMutex, portMAX_DELAY);
+	status = switchStatus;
+	xSemaphoreGive(switchStatusMutex);
+}
+
+bool WifiManager::getIPAddress(char* buffer, size_t size)
+{
+	if (!isConnected() || size == 0)
+		return false;
+
+	esp_ip4_addr_t addr = {};
+	addr.addr = staIpAddr.load();
+	return esp_ip4addr_ntoa(&addr, buffer, size) != nullptr;
+}
+
+bool WifiManager::setPowerProfile(PowerProfile profile, uint16_t interval)
+{
+	if (profile >= PowerProfile::Count || interval < 1 || interval > MAX_LISTEN_INTERVAL)
+		return false;
+
+	bool reassociate = false;
+
+	xSemaphoreTake(powerMutex, portMAX_DELAY);
+	int64_t now = esp_timer_get_time();
+	profileStats[static_cast<int>(powerProfile)].activeUs += now - profileSinceUs;
+	profileSinceUs = now;
+
+	reassociate = (profile == PowerProfile::MaxModem) && (interval != listenInterval);
+	powerProfile = profile;
+	listenInterval = interval;
+	xSemaphoreGive(powerMutex);
+
+	if (wifiDriverReady)
+	{
+		esp_err_t err = esp_wifi_set_ps(toPsType(profile));
+		if (err != ESP_OK)
+		{
+			ESP_LOGE(TAG, "Failed to set power save mode: %s", esp_err_to_name(err));
+			return false;
+		}
+
+		wifi_config_t staConfig;
+		if (esp_wifi_get_config(WIFI_IF_STA, &staConfig) == ESP_OK &&
+		    staConfig.sta.listen_interval != interval)
+		{
+			staConfig.sta.listen_interval = interval;
+			esp_wifi_set_config(WIFI_IF_STA, &staConfig);
+
+			// Listen interval is negotiated at association; the supervisor reconnects
+			if (reassociate && isConnected())
+			{
+				esp_wifi_disconnect();
+			}
+		}
+	}
+
+	ESP_LOGI(TAG, "Power profile %d, listen interval %u", static_cast<int>(profile), interval);
+	return savePowerSettings();
+}
+
+WifiManager::PowerProfile WifiManager::getPowerProfile()
+{
+	return powerProfile;
+}
+
+uint16_t WifiManager::getListenInterval()
+{
+	return listenInterval;
+}
+
+void WifiManager::recordRequestLatency(RequestDirection direction, uint32_t latencyMs)
+{
+	if (direction >= RequestDirection::Count)
+		return;
+
+	xSemaphoreTake(powerMutex, portMAX_DELAY);
+	LatencyAccumulator& acc = profileStats[static_cast<int>(powerProfile)].latency[static_cast<int>(direction)];
+	acc.requests++;
+	acc.latencySumMs += latencyMs;
+	if (latencyMs > acc.maxLatencyMs)
+	{
+		acc.maxLatencyMs = latencyMs;
+	}
+	xSemaphoreGive(powerMutex);
+}
+
+void WifiManager::getPowerStats(PowerProfile profile, PowerStats& stats)
+{
+	stats = {};
+	if (profile >= PowerProfile::Count)
+		return;
+
+	xSemaphoreTake(powerMutex, portMAX_DELAY);
+	const ProfileAccumulator& acc = profileStats[static_cast<int>(profile)];
+	int64_t activeUs = acc.activeUs;
+	if (profile == powerProfile && profileSinceUs != 0)
+	{
+		activeUs += esp_timer_get_time() - profileSinceUs;
+	}
+
+	LatencyStats* latency[] = {&stats.outbound, &stats.inbound};
+	for (int i = 0; i < static_cast<int>(RequestDirection::Count); i++)
+	{
+		const LatencyAccumulator& dir = acc.latency[i];
+		latency[i]->requests = dir.requests;
+		latency[i]->avgLatencyMs = dir.requests ? static_cast<uint32_t>(dir.latencySumMs / dir.requests) : 0;
+		latency[i]->maxLatencyMs = dir.maxLatencyMs;
+	}
+	stats.activeSeconds = static_cast<uint32_t>(activeUs / 1000000);
+	stats.wakeIntervalMs = wakeIntervalMs(profile, profile == PowerProfile::MaxModem ? listenInterval : 1);
+	stats.estimatedWakes = stats.wakeIntervalMs ? static_cast<uint32_t>(activeUs / 1000 / stats.wakeIntervalMs) : 0;
+	stats.beaconTimeouts = acc.beaconTimeouts;
+	xSemaphoreGive(powerMutex);
+}
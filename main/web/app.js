@@ -0,0 +1,212 @@
+// Convert hardware brightness (0-15) to UI percentage (10-100)
+// Hardware range 2-12 maps to UI 10-100%
+function hwToUi(hwValue) {
+    // Clamp to hardware limits
+    if (hwValue < 2) hwValue = 2;
+    if (hwValue > 12) hwValue = 12;
+    // Map 2-12 to 10-100
+    return Math.round((hwValue - 2) / 10 * 90 + 10);
+}
+
+// Convert UI percentage (10-100) to hardware brightness (2-12)
+function uiToHw(uiValue) {
+    // Clamp to UI limits
+    if (uiValue < 10) uiValue = 10;
+    if (uiValue > 100) uiValue = 100;
+    // Map 10-100 to 2-12
+    return Math.round((uiValue - 10) / 90 * 10 + 2);
+}
+
+function applyConfig(data) {
+    document.getElementById('showClock').checked = data.showClock;
+    document.getElementById('showWeather').checked = data.showWeather;
+    document.getElementById('showForecast').checked = data.showForecast || false;
+    document.getElementById('showStarWars').checked = data.showStarWars;
+    document.getElementById('showLOTR').checked = data.showLOTR;
+    document.getElementById('displayFlipped').checked = data.displayFlipped || false;
+
+    const brightness = data.brightness !== undefined ? data.brightness : 8;
+    const uiBrightness = hwToUi(brightness);
+    document.getElementById('brightness').value = uiBrightness;
+    document.getElementById('brightnessValue').textContent = uiBrightness;
+
+    document.getElementById('nightStart').value = data.nightStart || 0;
+    document.getElementById('nightEnd').value = data.nightEnd || 0;
+
+    document.getElementById('customText').value = data.customText || '';
+    document.getElementById('weatherApiKey').value = data.weatherApiKey || '';
+    document.getElementById('weatherLocations').value = (data.weatherLocations || []).join('\n');
+}
+
+// The server splices the current configuration into the page; this script
+// runs at the end of <body>, so the form is filled before first paint
+const embeddedConfig = document.getElementById('initialConfig');
+if (embeddedConfig && embeddedConfig.textContent.trim()) {
+    applyConfig(JSON.parse(embeddedConfig.textContent));
+} else {
+    fetch('/api/config')
+        .then(response => response.json())
+        .then(applyConfig)
+        .catch(err => console.error('Failed to load config:', err));
+}
+
+window.onload = function() {
+    loadPowerStats();
+
+    // Update brightness value display when slider changes
+    document.getElementById('brightness').addEventListener('input', function(e) {
+        document.getElementById('brightnessValue').textContent = e.target.value;
+    });
+};
+
+function saveConfig() {
+    const uiBrightness = parseInt(document.getElementById('brightness').value);
+    const hwBrightness = uiToHw(uiBrightness);
+
+    const config = {
+        showClock: document.getElementById('showClock').checked,
+        showWeather: document.getElementById('showWeather').checked,
+        showForecast: document.getElementById('showForecast').checked,
+        showStarWars: document.getElementById('showStarWars').checked,
+        showLOTR: document.getElementById('showLOTR').checked,
+        displayFlipped: document.getElementById('displayFlipped').checked,
+        brightness: hwBrightness,
+        nightStart: parseInt(document.getElementById('nightStart').value) || 0,
+        nightEnd: parseInt(document.getElementById('nightEnd').value) || 0,
+        customText: document.getElementById('customText').value,
+        weatherApiKey: document.getElementById('weatherApiKey').value,
+        weatherLocations: document.getElementById('weatherLocations').value
+            .split('\n').map(s => s.trim()).filter(s => s.length > 0)
+    };
+
+    fetch('/api/config', {
+        method: 'POST',
+        headers: { 'Content-Type': 'application/json' },
+        body: JSON.stringify(config)
+    })
+    .then(response => {
+        if (response.ok) {
+            showStatus('Configuration saved successfully!', 'success');
+        } else {
+            showStatus('Failed to save configuration', 'error');
+        }
+    })
+    .catch(err => {
+        showStatus('Error: ' + err.message, 'error');
+    });
+}
+
+function saveWiFi() {
+    const ssid = document.getElementById('wifiSSID').value;
+    const password = document.getElementById('wifiPassword').value;
+
+    if (!ssid) {
+        showStatus('Please enter WiFi SSID', 'error');
+        return;
+    }
+
+    if (confirm('The clock will switch to the new network. Continue?')) {
+        const wifi = { ssid, password };
+
+        fetch('/api/wifi', {
+            method: 'POST',
+            headers: { 'Content-Type': 'application/json' },
+            body: JSON.stringify(wifi)
+        })
+        .then(response => {
+            if (response.ok) {
+                showStatus('Connecting to ' + ssid + '...', 'success');
+                pollWiFiStatus(15);
+            } else {
+                showStatus('Failed to update WiFi', 'error');
+            }
+        })
+        .catch(err => {
+            showStatus('Error: ' + err.message, 'error');
+        });
+    }
+}
+
+// Poll switchover progress; the page may lose the device if it was
+// reached through the network being replaced
+function pollWiFiStatus(triesLeft) {
+    setTimeout(() => {
+        fetch('/api/wifi')
+            .then(response => response.json())
+            .then(data => {
+                if (data.state === 'connected') {
+                    showStatus('Connected to ' + data.ssid + ' (IP ' + data.ip + ')', 'success');
+                } else if (data.state === 'failed') {
+                    showStatus('Could not join ' + data.ssid + ', previous network restored', 'error');
+                } else if (triesLeft > 0) {
+                    pollWiFiStatus(triesLeft - 1);
+                }
+            })
+            .catch(() => {
+                if (triesLeft > 0) {
+                    pollWiFiStatus(triesLeft - 1);
+                } else {
+                    showStatus('Lost contact with the clock; it may now be on the new network', 'error');
+                }
+            });
+    }, 2000);
+}
+
+function loadPowerStats() {
+    fetch('/api/stats')
+        .then(response => response.json())
+        .then(data => {
+            const power = data.wifiPower;
+            document.getElementById('powerProfile').value = power.profile;
+            document.getElementById('listenInterval').value = power.listenInterval;
+
+            // Web = requests served by the clock, Fetch = weather requests it sends
+            let rows = '<tr><th align="left">Profile</th><th>Web reqs</th><th>Web avg/max ms</th>' +
+                       '<th>Fetch reqs</th><th>Fetch avg/max ms</th><th>Active s</th><th>Est. wakes</th>' +
+                       '<th>Missed beacons</th></tr>';
+            power.profiles.forEach(p => {
+                rows += '<tr><td>' + p.name + '</td><td align="center">' + p.inbound.requests +
+                        '</td><td align="center">' + p.inbound.avgLatencyMs + '/' + p.inbound.maxLatencyMs +
+                        '</td><td align="center">' + p.outbound.requests +
+                        '</td><td align="center">' + p.outbound.avgLatencyMs + '/' + p.outbound.maxLatencyMs +
+                        '</td><td align="center">' + p.activeSeconds + '</td><td align="center">' + p.estimatedWakes +
+                        '</td><td align="center">' + p.beaconTimeouts + '</td></tr>';
+            });
+            document.getElementById('powerStats').innerHTML = rows;
+        })
+        .catch(err => console.error('Failed to load stats:', err));
+}
+
+function savePower() {
+    const power = {
+        profile: document.getElementById('powerProfile').value,
+        listenInterval: parseInt(document.getElementById('listenInterval').value)
+    };
+
+    fetch('/api/wifi/power', {
+        method: 'POST',
+        headers: { 'Content-Type': 'application/json' },
+        body: JSON.stringify(power)
+    })
+    .then(response => {
+        if (response.ok) {
+            showStatus('Power profile applied', 'success');
+            loadPowerStats();
+        } else {
+            showStatus('Failed to apply power profile', 'error');
+        }
+    })
+    .catch(err => {
+        showStatus('Error: ' + err.message, 'error');
+    });
+}
+
+function showStatus(message, type) {
+    const statusEl = document.getElementById('status');
+    statusEl.textContent = message;
+    statusEl.className = 'status ' + type;
+
+    setTimeout(() => {
+        statusEl.className = 'status';
+    }, 5000);
+}
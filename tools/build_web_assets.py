@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+"""Minify, gzip and content-hash the web UI for embedding in the firmware.
+
+Reads index.html, app.css and app.js from the web directory and writes a
+C++ source defining the WEB_ASSETS table declared in main/inc/WebAssets.hpp.
+Each asset is stored both minified and gzipped, with a strong ETag taken
+from its content hash. The stylesheet and script are renamed to
+/assets/<name>.<hash>.<ext> so they can be cached as immutable; index.html
+is rewritten to reference the hashed names, and its {{CONFIG}} placeholder
+is cut out and recorded as the offset where the server splices in the
+current configuration.
+
+Invoked by main/CMakeLists.txt; can also be run by hand:
+    python3 tools/build_web_assets.py main/web build/WebAssets.cpp
+"""
+
+import argparse
+import gzip
+import hashlib
+import os
+import re
+
+CONFIG_PLACEHOLDER = "{{CONFIG}}"
+
+CONTENT_TYPES = {
+    ".html": "text/html; charset=utf-8",
+    ".css": "text/css; charset=utf-8",
+    ".js": "application/javascript; charset=utf-8",
+}
+
+
+def minify_css(text):
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    text = re.sub(r"\s+", " ", text)
+    text = re.sub(r"\s*([{};:,>])\s*", r"\1", text)
+    return text.replace(";}", "}").strip()
+
+
+def minify_js(text):
+    # Conservative: keep line breaks so automatic semicolon insertion is
+    # unaffected, drop indentation, blank lines and whole-line comments
+    lines = []
+    for line in text.splitlines():
+        line = line.strip()
+        if line and not line.startswith("//"):
+            lines.append(line)
+    return "\n".join(lines)
+
+
+def minify_html(text):
+    text = re.sub(r"<!--.*?-->", "", text, flags=re.S)
+    lines = [line.strip() for line in text.splitlines()]
+    return "\n".join(line for line in lines if line)
+
+
+def content_hash(data):
+    return hashlib.sha256(data).hexdigest()[:12]
+
+
+def c_array(name, data):
+    rows = []
+    for i in range(0, len(data), 20):
+        rows.append("\t" + ", ".join("0x%02x" % b for b in data[i:i + 20]) + ",")
+    return "\tconst uint8_t %s[] = {\n%s\n\t};\n" % (name, "\n".join("\t" + row for row in rows))
+
+
+def build(web_dir):
+    def read(name):
+        with open(os.path.join(web_dir, name), encoding="utf-8") as f:
+            return f.read()
+
+    assets = []
+    html = minify_html(read("index.html"))
+
+    for name, minify in (("app.css", minify_css), ("app.js", minify_js)):
+        data = minify(read(name)).encode()
+        stem, ext = os.path.splitext(name)
+        digest = content_hash(data)
+        path = "/assets/%s.%s%s" % (stem, digest, ext)
+        html = html.replace('"%s"' % name, '"%s"' % path)
+        assets.append({"path": path, "ext": ext, "data": data, "digest": digest, "immutable": True, "splice": 0})
+
+    # The page is sent in two pieces around the config JSON, so it is not
+    # stored gzipped; the hash still identifies the static template
+    splice = html.find(CONFIG_PLACEHOLDER)
+    if splice <= 0:
+        raise SystemExit("index.html has no %s placeholder" % CONFIG_PLACEHOLDER)
+    data = html.replace(CONFIG_PLACEHOLDER, "", 1).encode()
+    splice = len(html[:splice].encode())
+    assets.insert(0, {"path": "/", "ext": ".html", "data": data, "digest": content_hash(data), "immutable": False,
+                      "splice": splice})
+    return assets
+
+
+def write_source(assets, output):
+    parts = [
+        "// Generated by tools/build_web_assets.py - do not edit\n\n",
+        '#include "WebAssets.hpp"\n\n',
+        "namespace\n{\n",
+    ]
+
+    for i, asset in enumerate(assets):
+        parts.append(c_array("asset%d" % i, asset["data"]))
+        if not asset["splice"]:
+            parts.append(c_array("asset%dGzip" % i, gzip.compress(asset["data"], 9, mtime=0)))
+    parts.append("}\n\nconst WebAsset WEB_ASSETS[] = {\n")
+
+    for i, asset in enumerate(assets):
+        gz = "nullptr, 0" if asset["splice"] else "asset%dGzip, sizeof(asset%dGzip)" % (i, i)
+        parts.append('\t{"%s", "%s", "\\"%s\\"", asset%d, sizeof(asset%d), %s, %d, %s},\n'
+                     % (asset["path"], CONTENT_TYPES[asset["ext"]], asset["digest"], i, i, gz, asset["splice"],
+                        "true" if asset["immutable"] else "false"))
+
+    parts.append("};\n\nconst size_t WEB_ASSET_COUNT = sizeof(WEB_ASSETS) / sizeof(WEB_ASSETS[0]);\n")
+
+    with open(output, "w") as f:
+        f.write("".join(parts))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Build the embedded web UI assets")
+    parser.add_argument("web_dir")
+    parser.add_argument("output")
+    args = parser.parse_args()
+
+    assets = build(args.web_dir)
+    write_source(assets, args.output)
+
+    for asset in assets:
+        print("%-28s %6d bytes, %6d gzipped" % (asset["path"], len(asset["data"]),
+                                               len(gzip.compress(asset["data"], 9, mtime=0))))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,306 @@
+/**
+ * @file bench.cpp
+ * @brief Host benchmark for the weather response parsers
+ *
+ * Feeds the replay fixtures through the provider's parsers in several
+ * chunk sizes, the way HTTP_EVENT_ON_DATA delivers them, and reports parse
+ * time, peak heap and allocation count per fetch. Built by run.sh; the
+ * allocator is wrapped at link time so every malloc is counted.
+ *
+ * Define WITH_CJSON (run.sh does when CJSON_DIR is set) to add a baseline
+ * that buffers the whole body and parses it with cJSON.
+ */
+
+#include "OpenWeatherMapProvider.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <malloc.h>
+#include <new>
+#include <string>
+
+#ifdef WITH_CJSON
+#include "cJSON.h"
+#endif
+
+extern "C"
+{
+	void* __real_malloc(size_t size);
+	void* __real_calloc(size_t count, size_t size);
+	void* __real_realloc(void* ptr, size_t size);
+	void __real_free(void* ptr);
+}
+
+namespace
+{
+	struct HeapStats
+	{
+		bool counting;
+		size_t allocations;
+		size_t live;
+		size_t peak;
+	};
+
+	HeapStats heap = {};
+
+	void track(void* ptr)
+	{
+		if (ptr == nullptr || !heap.counting)
+			return;
+		heap.allocations++;
+		heap.live += malloc_usable_size(ptr);
+		if (heap.live > heap.peak)
+			heap.peak = heap.live;
+	}
+
+	void untrack(void* ptr)
+	{
+		if (ptr == nullptr || !heap.counting)
+			return;
+		size_t size = malloc_usable_size(ptr);
+		heap.live = size > heap.live ? 0 : heap.live - size;
+	}
+}
+
+extern "C"
+{
+	void* __wrap_malloc(size_t size)
+	{
+		void* ptr = __real_malloc(size);
+		track(ptr);
+		return ptr;
+	}
+
+	void* __wrap_calloc(size_t count, size_t size)
+	{
+		void* ptr = __real_calloc(count, size);
+		track(ptr);
+		return ptr;
+	}
+
+	void* __wrap_realloc(void* ptr, size_t size)
+	{
+		untrack(ptr);
+		void* result = __real_realloc(ptr, size);
+		track(result);
+		return result;
+	}
+
+	void __wrap_free(void* ptr)
+	{
+		untrack(ptr);
+		__real_free(ptr);
+	}
+}
+
+// libstdc++ allocates internally, out of reach of --wrap
+void* operator new(size_t size)
+{
+	void* ptr = __wrap_malloc(size);
+	if (ptr == nullptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void operator delete(void* ptr) noexcept { __wrap_free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { __wrap_free(ptr); }
+
+namespace
+{
+	const size_t CHUNK_SIZES[] = {1, 64, 512, 0};  // 0 = whole body at once
+
+	struct Result
+	{
+		double usPerFetch;
+		double allocationsPerFetch;
+		size_t peakBytes;
+		bool ok;
+	};
+
+	bool loadFile(const std::string& path, std::string& out)
+	{
+		FILE* f = fopen(path.c_str(), "rb");
+		if (f == nullptr)
+			return false;
+
+		char buf[4096];
+		size_t n;
+		while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+		{
+			out.append(buf, n);
+		}
+		fclose(f);
+		return !out.empty();
+	}
+
+	// Mirror the replay server's "large" mode: unused fields to skip
+	std::string padBody(const std::string& body, size_t kb)
+	{
+		std::string padded = body.substr(0, body.rfind('}'));
+		padded += ",\"padding\":[";
+		for (size_t i = 0; i < kb * 10; i++)
+		{
+			padded += (i ? ",\"" : "\"");
+			padded.append(100, 'x');
+			padded += '"';
+		}
+		padded += "]}";
+		return padded;
+	}
+
+	template <typename Fetch>
+	Result measure(int iterations, Fetch fetch)
+	{
+		Result result = {};
+		result.ok = fetch();  // warm-up, and a correctness check
+
+		heap = {};
+		heap.counting = true;
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < iterations; i++)
+		{
+			fetch();
+		}
+		auto elapsed = std::chrono::steady_clock::now() - start;
+		heap.counting = false;
+
+		result.usPerFetch = std::chrono::duration<double, std::micro>(elapsed).count() / iterations;
+		result.allocationsPerFetch = static_cast<double>(heap.allocations) / iterations;
+		result.peakBytes = heap.peak;
+		return result;
+	}
+
+	bool feedChunks(ResponseParser& parser, const std::string& body, size_t chunk)
+	{
+		if (chunk == 0)
+			chunk = body.size();
+
+		for (size_t i = 0; i < body.size(); i += chunk)
+		{
+			size_t len = body.size() - i < chunk ? body.size() - i : chunk;
+			if (!parser.feed(body.data() + i, len))
+				return false;
+		}
+		return parser.finish();
+	}
+
+	void report(const char* fixture, const char* parser, size_t chunk, const Result& r)
+	{
+		char chunkText[24];
+		if (chunk == 0)
+			snprintf(chunkText, sizeof(chunkText), "whole");
+		else
+			snprintf(chunkText, sizeof(chunkText), "%zu", chunk);
+
+		printf("%-14s %-10s %6s %12.1f %10zu %10.1f %s\n", fixture, parser, chunkText,
+		       r.usPerFetch, r.peakBytes, r.allocationsPerFetch, r.ok ? "ok" : "FAILED");
+	}
+
+#ifdef WITH_CJSON
+	// Buffer-then-parse, the approach the streaming parser replaced
+	bool cjsonCurrent(const std::string& body, WeatherData& data)
+	{
+		char* copy = static_cast<char*>(malloc(body.size() + 1));
+		memcpy(copy, body.data(), body.size());
+		copy[body.size()] = '\0';
+
+		cJSON* root = cJSON_Parse(copy);
+		free(copy);
+		if (root == nullptr)
+			return false;
+
+		cJSON* main = cJSON_GetObjectItem(root, "main");
+		cJSON* temp = main ? cJSON_GetObjectItem(main, "temp") : nullptr;
+		cJSON* humidity = main ? cJSON_GetObjectItem(main, "humidity") : nullptr;
+		cJSON* weather = cJSON_GetArrayItem(cJSON_GetObjectItem(root, "weather"), 0);
+		cJSON* description = weather ? cJSON_GetObjectItem(weather, "description") : nullptr;
+
+		data.valid = cJSON_IsNumber(temp);
+		if (data.valid)
+		{
+			data.temperature = static_cast<float>(temp->valuedouble);
+			data.humidity = cJSON_IsNumber(humidity) ? humidity->valueint : 0;
+			if (cJSON_IsString(description))
+			{
+				strncpy(data.description, description->valuestring, sizeof(data.description) - 1);
+			}
+		}
+		cJSON_Delete(root);
+		return data.valid;
+	}
+#endif
+}
+
+int main(int argc, char** argv)
+{
+	std::string fixtureDir = argc > 1 ? argv[1] : "tools/weather_replay/fixtures";
+	int iterations = argc > 2 ? atoi(argv[2]) : 200;
+	if (iterations <= 0)
+		iterations = 1;
+
+	std::string current;
+	std::string forecast;
+	if (!loadFile(fixtureDir + "/weather.json", current) || !loadFile(fixtureDir + "/forecast.json", forecast))
+	{
+		fprintf(stderr, "Cannot read fixtures from %s\n", fixtureDir.c_str());
+		return 1;
+	}
+	std::string largeForecast = padBody(forecast, 64);
+
+	// Heap-allocated once, like the firmware's static provider instance
+	OpenWeatherMapProvider* provider = new OpenWeatherMapProvider();
+	WeatherData weather;
+	ForecastData days;
+	bool allOk = true;
+
+	printf("%d iterations per row, sizeof(OpenWeatherMapProvider) = %zu bytes\n\n",
+	       iterations, sizeof(OpenWeatherMapProvider));
+	printf("%-14s %-10s %6s %12s %10s %10s\n", "fixture", "parser", "chunk", "us/fetch", "peak B", "allocs");
+
+	for (size_t chunk : CHUNK_SIZES)
+	{
+		Result r = measure(iterations, [&] {
+			return feedChunks(provider->beginCurrent(weather), current, chunk);
+		});
+		report("weather", "streaming", chunk, r);
+		allOk &= r.ok;
+	}
+
+	for (size_t chunk : CHUNK_SIZES)
+	{
+		Result r = measure(iterations, [&] {
+			return feedChunks(provider->beginForecast(days), forecast, chunk);
+		});
+		report("forecast", "streaming", chunk, r);
+		allOk &= r.ok;
+	}
+
+	for (size_t chunk : CHUNK_SIZES)
+	{
+		Result r = measure(iterations, [&] {
+			return feedChunks(provider->beginForecast(days), largeForecast, chunk);
+		});
+		report("forecast+64k", "streaming", chunk, r);
+		allOk &= r.ok;
+	}
+
+	// A truncated body must be rejected, never half-published
+	std::string truncated = forecast.substr(0, forecast.size() / 2);
+	bool rejected = !feedChunks(provider->beginForecast(days), truncated, 512) && !days.valid;
+	printf("\ntruncated forecast rejected: %s\n", rejected ? "yes" : "NO");
+	allOk &= rejected;
+
+#ifdef WITH_CJSON
+	printf("\n");
+	Result r = measure(iterations, [&] {
+		weather = {};
+		return cjsonCurrent(current, weather);
+	});
+	report("weather", "cJSON", 0, r);
+	allOk &= r.ok;
+#endif
+
+	delete provider;
+	return allOk ? 0 : 1;
+}
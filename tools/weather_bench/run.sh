@@ -0,0 +1,33 @@
+#!/bin/bash
+# Build and run the host weather parse benchmark
+#
+# Usage: tools/weather_bench/run.sh [iterations]
+# Set CJSON_DIR to a directory holding cJSON.c/cJSON.h to add a cJSON baseline.
+
+set -e
+
+ROOT="$(cd "$(dirname "${BASH_SOURCE[0]}")/../.." && pwd)"
+OUT="${ROOT}/_bench_build"
+CXX="${CXX:-g++}"
+CC="${CC:-gcc}"
+
+mkdir -p "${OUT}"
+
+SOURCES=(
+	"${ROOT}/tools/weather_bench/bench.cpp"
+	"${ROOT}/main/src/JsonScanner.cpp"
+	"${ROOT}/main/src/OpenWeatherMapProvider.cpp"
+)
+FLAGS=(-std=gnu++17 -O2 -Wall -I"${ROOT}/main/inc")
+OBJECTS=()
+
+if [ -n "${CJSON_DIR}" ]; then
+	"${CC}" -O2 -c "${CJSON_DIR}/cJSON.c" -o "${OUT}/cJSON.o"
+	FLAGS+=(-DWITH_CJSON -I"${CJSON_DIR}")
+	OBJECTS+=("${OUT}/cJSON.o")
+fi
+
+"${CXX}" "${FLAGS[@]}" "${SOURCES[@]}" "${OBJECTS[@]}" -o "${OUT}/weather_bench" \
+	-Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free
+
+"${OUT}/weather_bench" "${ROOT}/tools/weather_replay/fixtures" "${1:-200}"
@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+"""Local stand-in for the OpenWeatherMap API.
+
+Replays the recorded responses in fixtures/ so the clock's weather fetcher
+can be exercised and measured without network access or an API key. Point
+CONFIG_WEATHER_API_BASE_URL at this server, e.g. http://192.168.1.10:8080.
+
+Modes shape how every response is delivered:
+  normal     Content-Length body in one write
+  chunked    Transfer-Encoding: chunked in small pieces
+  large      body padded with an unused field to roughly --pad-kb kilobytes
+  slow       body dripped out in small pieces with --delay between them
+  malformed  body cut short or corrupted (alternates per request)
+
+ETag / If-None-Match is honoured, so conditional revalidation answers
+304 Not Modified exactly like the real service.
+"""
+
+import argparse
+import hashlib
+import json
+import os
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlparse
+
+FIXTURE_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "fixtures")
+
+ROUTES = {
+    "/data/2.5/weather": "weather.json",
+    "/data/2.5/forecast": "forecast.json",
+}
+
+MODES = ("normal", "chunked", "large", "slow", "malformed")
+
+
+def load_fixture(name, mode, pad_kb):
+    with open(os.path.join(FIXTURE_DIR, name), "rb") as f:
+        body = f.read().strip()
+
+    if mode == "large":
+        # Unused fields the parser has to skip; the real API sends plenty
+        doc = json.loads(body)
+        doc["padding"] = ["x" * 100 for _ in range(pad_kb * 10)]
+        body = json.dumps(doc, separators=(",", ":")).encode()
+
+    return body
+
+
+class ReplayHandler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    server_version = "WeatherReplay/1.0"
+
+    def do_GET(self):
+        url = urlparse(self.path)
+        fixture = ROUTES.get(url.path)
+        if fixture is None:
+            self.send_error(404, "Unknown endpoint")
+            return
+
+        query = parse_qs(url.query)
+        if "appid" not in query:
+            self.send_json_error(401, "Invalid API key")
+            return
+
+        opts = self.server.options
+        body = load_fixture(fixture, opts.mode, opts.pad_kb)
+        etag = '"%s"' % hashlib.sha1(body).hexdigest()[:16]
+
+        if opts.mode != "malformed" and self.headers.get("If-None-Match") == etag:
+            self.send_response(304)
+            self.send_header("ETag", etag)
+            self.send_header("Content-Length", "0")
+            self.end_headers()
+            return
+
+        if opts.mode == "malformed":
+            self.server.malformed_count += 1
+            if self.server.malformed_count % 2:
+                body = body[: len(body) // 2]
+            else:
+                body = body.replace(b":", b";", 3)
+
+        self.send_response(200)
+        self.send_header("Content-Type", "application/json; charset=utf-8")
+        self.send_header("ETag", etag)
+        self.send_header("Last-Modified", self.date_time_string(int(self.server.started)))
+
+        if opts.mode == "chunked":
+            self.send_header("Transfer-Encoding", "chunked")
+            self.end_headers()
+            for i in range(0, len(body), opts.chunk):
+                piece = body[i:i + opts.chunk]
+                self.wfile.write(b"%x\r\n%s\r\n" % (len(piece), piece))
+            self.wfile.write(b"0\r\n\r\n")
+            return
+
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+
+        if opts.mode == "slow":
+            for i in range(0, len(body), opts.chunk):
+                self.wfile.write(body[i:i + opts.chunk])
+                self.wfile.flush()
+                time.sleep(opts.delay)
+        else:
+            self.wfile.write(body)
+
+    def send_json_error(self, code, message):
+        body = json.dumps({"cod": code, "message": message}).encode()
+        self.send_response(code)
+        self.send_header("Content-Type", "application/json; charset=utf-8")
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def log_message(self, fmt, *args):
+        if not self.server.options.quiet:
+            super().log_message(fmt, *args)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="0.0.0.0", help="address to bind (default: all interfaces)")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--mode", choices=MODES, default="normal")
+    parser.add_argument("--chunk", type=int, default=256, help="bytes per piece in chunked/slow modes")
+    parser.add_argument("--delay", type=float, default=0.2, help="seconds between pieces in slow mode")
+    parser.add_argument("--pad-kb", type=int, default=64, help="approximate padding in large mode")
+    parser.add_argument("--quiet", action="store_true", help="do not log requests")
+    options = parser.parse_args()
+
+    server = ThreadingHTTPServer((options.host, options.port), ReplayHandler)
+    server.options = options
+    server.started = time.time()
+    server.malformed_count = 0
+
+    print("Replaying %s on http://%s:%d (%s mode)" % (FIXTURE_DIR, options.host, options.port, options.mode))
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()